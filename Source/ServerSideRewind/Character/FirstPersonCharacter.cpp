@@ -44,77 +44,86 @@ AFirstPersonCharacter::AFirstPersonCharacter()
 	*/
 	HitBoxHead = CreateDefaultSubobject<UBoxComponent>(TEXT("HitBoxHead"));
 	HitBoxHead->SetupAttachment(GetMesh(), "head");
-	HitBoxes.Add("head", HitBoxHead);
+	RegisterHitBox("head", HitBoxHead);
 
 	HitBoxUpperTorso = CreateDefaultSubobject<UBoxComponent>(TEXT("HitBoxUpperTorso"));
 	HitBoxUpperTorso->SetupAttachment(GetMesh(), "spine_03");
-	HitBoxes.Add("spine_03", HitBoxUpperTorso);
+	RegisterHitBox("spine_03", HitBoxUpperTorso);
 
 	HitBoxLowerTorso = CreateDefaultSubobject<UBoxComponent>(TEXT("HitBoxLowerTorso"));
 	HitBoxLowerTorso->SetupAttachment(GetMesh(), "spine_01");
-	HitBoxes.Add("spine_01", HitBoxLowerTorso);
+	RegisterHitBox("spine_01", HitBoxLowerTorso);
 
 	HitBoxRightUpperArm = CreateDefaultSubobject<UBoxComponent>(TEXT("HitBoxRightUpperArm"));
 	HitBoxRightUpperArm->SetupAttachment(GetMesh(), "upperarm_r");
-	HitBoxes.Add("upperarm_r", HitBoxRightUpperArm);
+	RegisterHitBox("upperarm_r", HitBoxRightUpperArm);
 
 	HitBoxRightLowerArm = CreateDefaultSubobject<UBoxComponent>(TEXT("HitBoxRightLowerArm"));
 	HitBoxRightLowerArm->SetupAttachment(GetMesh(), "lowerarm_r");
-	HitBoxes.Add("lowerarm_r", HitBoxRightLowerArm);
+	RegisterHitBox("lowerarm_r", HitBoxRightLowerArm);
 
 	HitBoxRightHand = CreateDefaultSubobject<UBoxComponent>(TEXT("HitBoxRightHand"));
 	HitBoxRightHand->SetupAttachment(GetMesh(), "hand_r");
-	HitBoxes.Add("hand_r", HitBoxRightHand);
+	RegisterHitBox("hand_r", HitBoxRightHand);
 
 	HitBoxLeftUpperArm = CreateDefaultSubobject<UBoxComponent>(TEXT("HitBoxLeftUpperArm"));
 	HitBoxLeftUpperArm->SetupAttachment(GetMesh(), "upperarm_l");
-	HitBoxes.Add("upperarm_l", HitBoxLeftUpperArm);
+	RegisterHitBox("upperarm_l", HitBoxLeftUpperArm);
 
 	HitBoxLeftLowerArm = CreateDefaultSubobject<UBoxComponent>(TEXT("HitBoxLeftLowerArm"));
 	HitBoxLeftLowerArm->SetupAttachment(GetMesh(), "lowerarm_l");
-	HitBoxes.Add("lowerarm_l", HitBoxLeftLowerArm);
+	RegisterHitBox("lowerarm_l", HitBoxLeftLowerArm);
 
 	HitBoxLeftHand = CreateDefaultSubobject<UBoxComponent>(TEXT("HitBoxLeftHand"));
 	HitBoxLeftHand->SetupAttachment(GetMesh(), "hand_l");
-	HitBoxes.Add("hand_l", HitBoxLeftHand);
+	RegisterHitBox("hand_l", HitBoxLeftHand);
 
 	HitBoxRightUpperLeg = CreateDefaultSubobject<UBoxComponent>(TEXT("HitBoxRightUpperLeg"));
 	HitBoxRightUpperLeg->SetupAttachment(GetMesh(), "thigh_r");
-	HitBoxes.Add("thigh_r", HitBoxRightUpperLeg);
+	RegisterHitBox("thigh_r", HitBoxRightUpperLeg);
 
 	HitBoxRightLowerLeg = CreateDefaultSubobject<UBoxComponent>(TEXT("HitBoxRightLowerLeg"));
 	HitBoxRightLowerLeg->SetupAttachment(GetMesh(), "calf_r");
-	HitBoxes.Add("calf_r", HitBoxRightLowerLeg);
+	RegisterHitBox("calf_r", HitBoxRightLowerLeg);
 
 	HitBoxRightFoot = CreateDefaultSubobject<UBoxComponent>(TEXT("HitBoxRightFoot"));
 	HitBoxRightFoot->SetupAttachment(GetMesh(), "foot_r");
-	HitBoxes.Add("foot_r", HitBoxRightFoot);
+	RegisterHitBox("foot_r", HitBoxRightFoot);
 
 	HitBoxLeftUpperLeg = CreateDefaultSubobject<UBoxComponent>(TEXT("HitBoxLeftUpperLeg"));
 	HitBoxLeftUpperLeg->SetupAttachment(GetMesh(), "thigh_l");
-	HitBoxes.Add("thigh_l", HitBoxLeftUpperLeg);
+	RegisterHitBox("thigh_l", HitBoxLeftUpperLeg);
 
 	HitBoxLeftLowerLeg = CreateDefaultSubobject<UBoxComponent>(TEXT("HitBoxLeftLowerLeg"));
 	HitBoxLeftLowerLeg->SetupAttachment(GetMesh(), "calf_l");
-	HitBoxes.Add("calf_l", HitBoxLeftLowerLeg);
+	RegisterHitBox("calf_l", HitBoxLeftLowerLeg);
 
 	HitBoxLeftFoot = CreateDefaultSubobject<UBoxComponent>(TEXT("HitBoxLeftFoot"));
 	HitBoxLeftFoot->SetupAttachment(GetMesh(), "foot_l");
-	HitBoxes.Add("foot_l", HitBoxLeftFoot);
+	RegisterHitBox("foot_l", HitBoxLeftFoot);
 
-	for (auto HitBox : HitBoxes)
+	for (UBoxComponent* HitBox : HitBoxes)
 	{
-		if (HitBox.Value)
+		if (HitBox)
 		{
-			HitBox.Value->SetCollisionObjectType(ECollisionChannel::ECC_GameTraceChannel1);
-			HitBox.Value->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
-			HitBox.Value->SetCollisionResponseToChannel(ECollisionChannel::ECC_GameTraceChannel1,
+			HitBox->SetCollisionObjectType(ECollisionChannel::ECC_GameTraceChannel1);
+			HitBox->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
+			HitBox->SetCollisionResponseToChannel(ECollisionChannel::ECC_GameTraceChannel1,
 				ECollisionResponse::ECR_Block);
-			HitBox.Value->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+			HitBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
 		}
 	}
 }
 
+void AFirstPersonCharacter::RegisterHitBox(FName BoneName, UBoxComponent* HitBox)
+{
+	checkf(HitBoxes.Num() < ServerSideRewind::MaxHitBoxes, TEXT("Too many hitboxes registered"));
+
+	/** Index of the hitbox in both arrays is its index in every server side rewind snapshot */
+	HitBoxBoneNames.Add(BoneName);
+	HitBoxes.Add(HitBox);
+}
+
 void AFirstPersonCharacter::BeginPlay()
 {
 	Super::BeginPlay();
@@ -129,16 +138,28 @@ void AFirstPersonCharacter::BeginPlay()
 		}
 	}
 
-	/** Add crosshair widget to the viewport */
-	if (CrosshairWidgetClass)
+	/** Add crosshair widget to the viewport (only for the local player, servers and other characters have none) */
+	if (CrosshairWidgetClass && IsLocallyControlled())
 	{
-		CreateWidget<UUserWidget>(GetWorld(), CrosshairWidgetClass)->AddToViewport();
+		if (UUserWidget* CrosshairWidget = CreateWidget<UUserWidget>(GetWorld(), CrosshairWidgetClass))
+		{
+			CrosshairWidget->AddToViewport();
+		}
 	}
 }
 
 void AFirstPersonCharacter::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+
+	/** Send the shots fired this frame in one batch and resend batches that weren't acked in time */
+	if (IsLocallyControlled() && !HasAuthority())
+	{
+		ShotSender.Flush(GetWorld()->GetTimeSeconds(), [this](const FServerSideRewindShotBatch& Batch)
+		{
+			ServerReportShots(Batch);
+		});
+	}
 }
 
 void AFirstPersonCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
@@ -205,8 +226,8 @@ void AFirstPersonCharacter::KillButtonPressed()
 
 	/** Start of the line trace offset by 1 meter to avoid hitting own mesh */
 	FVector Start = ViewportCenterWorldPosition + ViewportCenterWorldDirection * 100.0f;
-	/** End of the line trace 1000 meters from start */
-	FVector End = Start + ViewportCenterWorldDirection * 100000.0f;
+	/** End of the line trace at the shot range from start */
+	FVector End = Start + ViewportCenterWorldDirection * ShotRange;
 
 	AFirstPersonCharacter* HitCharacter = (AFirstPersonCharacter*) nullptr;
 
@@ -234,8 +255,12 @@ void AFirstPersonCharacter::KillButtonPressed()
 	/** Handle server (Check for kill without server side rewind) */
 	if (HasAuthority()) { CheckForKill(Start, End); }
 
-	/** Handle clients (Request server to check for kill) */
-	else { ServerKillButtonPressed(HitCharacter, GameState->GetServerWorldTimeSeconds(), Start, End); }
+	/** Handle clients (Request server to check for kill with the next shot batch) */
+	else
+	{
+		const FServerSideRewindFrameTime Time = ServerSideRewind::ToFrameTime(GameState->GetServerWorldTimeSeconds());
+		ShotSender.AddShot(Time, Start, ViewportCenterWorldDirection);
+	}
 }
 
 void AFirstPersonCharacter::CheckForKill(FVector Start, FVector End)
@@ -252,20 +277,40 @@ void AFirstPersonCharacter::CheckForKill(FVector Start, FVector End)
 	}
 }
 
-void AFirstPersonCharacter::CheckForKillServerSideRewind(AFirstPersonCharacter* HitCharacter, 
-	float Time, FVector Start, FVector End)
+void AFirstPersonCharacter::CheckForKillServerSideRewind(const FServerSideRewindFrameTime& Time, FVector Start,
+	FVector End)
+{
+	if (ServerSideRewindComponent == nullptr) { return; }
+
+	/** Checked together with all other shots of this frame, hit character is killed by the subsystem */
+	ServerSideRewindComponent->QueueKillCheck(Time, Start, End, ShotPenetration + 1);
+}
+
+void AFirstPersonCharacter::ServerReportShots_Implementation(const FServerSideRewindShotBatch& Batch)
 {
-	if (ServerSideRewindComponent == nullptr || HitCharacter == nullptr) { return; }
+	/** Batches can't be bigger than the client sends them */
+	if (Batch.Shots.Num() > ServerSideRewind::MaxShotsPerBatch) { return; }
 
-	/** Kill player if check was successful */
-	if (ServerSideRewindComponent->CheckForKill(HitCharacter, Time, Start, End))
+	/** Resent batches whose ack got lost are only acked again */
+	const bool bNewBatch = ShotReceiver.Receive(Batch.Sequence);
+	ClientAckShots(ShotReceiver.GetLatestSequence(), ShotReceiver.GetAckBits());
+	if (!bNewBatch) { return; }
+
+	/** Shots are only rewound as far as the latency of the connection explains */
+	if (ServerSideRewindComponent != nullptr) { ServerSideRewindComponent->UpdateRoundTripTime(); }
+
+	for (const FServerSideRewindShotReport& Shot : Batch.Shots)
 	{
-		HitCharacter->MulticastRagdoll();
+		HandleReportedShot(Shot.GetTime(Batch.Frame), Shot.Start, Shot.Start + Shot.GetDirection() * ShotRange);
 	}
 }
 
-void AFirstPersonCharacter::ServerKillButtonPressed_Implementation(AFirstPersonCharacter* HitCharacter, 
-	float Time, FVector Start, FVector End)
+void AFirstPersonCharacter::ClientAckShots_Implementation(uint16 LatestSequence, uint32 AckBits)
+{
+	ShotSender.Acknowledge(LatestSequence, AckBits);
+}
+
+void AFirstPersonCharacter::HandleReportedShot(const FServerSideRewindFrameTime& Time, FVector Start, FVector End)
 {
 	/** Get game mode */
 	AGameModeBase* GameModeBase = UGameplayStatics::GetGameMode(this);
@@ -276,7 +321,7 @@ void AFirstPersonCharacter::ServerKillButtonPressed_Implementation(AFirstPersonC
 	if (GameMode == nullptr) { return; }
 
 	/** Initiate checking for kill depending on server side rewind settings */
-	if (GameMode->bUseServerSideRewind) { CheckForKillServerSideRewind(HitCharacter, Time, Start, End); }
+	if (GameMode->bUseServerSideRewind) { CheckForKillServerSideRewind(Time, Start, End); }
 	else { CheckForKill(Start, End); }
 }
 
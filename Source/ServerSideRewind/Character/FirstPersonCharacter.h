@@ -2,6 +2,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "ServerSideRewind/Components/ServerSideRewindShotReport.h"
 #include "FirstPersonCharacter.generated.h"
 
 
@@ -23,13 +24,22 @@ class SERVERSIDEREWIND_API AFirstPersonCharacter : public ACharacter
 
 public:
 	AFirstPersonCharacter();
+	friend class UServerSideRewindSubsystem;
 	virtual void Tick(float DeltaTime) override;
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
 	FORCEINLINE UServerSideRewindComponent* GetServerSideRewindComponent() { return ServerSideRewindComponent; }
 
-	/** Map storing all hit boxes */
-	TMap<FName, UBoxComponent*> HitBoxes;
+	/**
+	* All hit boxes and the names of the bones they are attached to.
+	* Built once in the constructor, the array index is used as the hitbox index in snapshots.
+	*/
+	TArray<UBoxComponent*> HitBoxes;
+	TArray<FName> HitBoxBoneNames;
+
+	/** Multicast remote procedure call to enable ragdoll when character is killed */
+	UFUNCTION(NetMulticast, Reliable)
+	void MulticastRagdoll();
 
 protected:
 	virtual void BeginPlay() override;
@@ -95,6 +105,9 @@ private:
 	UPROPERTY(EditAnywhere)
 	UBoxComponent* HitBoxLeftFoot;
 
+	/** Adds hitbox to the hitbox index table (constructor only) */
+	void RegisterHitBox(FName BoneName, UBoxComponent* HitBox);
+
 	/** Character mapping context */
 	UPROPERTY(EditAnywhere, meta = (AllowPrivateAccess = "true"))
 	UInputMappingContext* MappingContextCharacter;
@@ -119,6 +132,10 @@ private:
 	UPROPERTY(EditAnywhere, meta = (AllowPrivateAccess = "true"))
 	TSubclassOf<UUserWidget> CrosshairWidgetClass;
 
+	/** Amount of characters a shot passes through after hitting the first one (server side rewind only) */
+	UPROPERTY(EditAnywhere, meta = (AllowPrivateAccess = "true", ClampMin = "0"))
+	int32 ShotPenetration = 0;
+
 	/** Called for movement input */
 	void Move(const FInputActionValue& Value);
 
@@ -128,18 +145,34 @@ private:
 	/** Called when the spot button is pressed */
 	void KillButtonPressed();
 
-	/** Server remote procedure call to check for kill */
-	UFUNCTION(Server, Reliable)
-	void ServerKillButtonPressed(AFirstPersonCharacter* HitCharacter, float Time, FVector Start, FVector End);
+	/** Length of a shot in cm (the server traces along the reported direction up to this length) */
+	UPROPERTY(EditAnywhere, meta = (AllowPrivateAccess = "true"))
+	float ShotRange = 100000.0f;
+
+	/** Collects the shots fired during a frame into one batch and resends it until acked (client only) */
+	FServerSideRewindShotSender ShotSender;
+
+	/** Sequences of the shot batches received from the owning client (server only) */
+	FServerSideRewindShotReceiver ShotReceiver;
+
+	/**
+	* Server remote procedure call to check shots fired during one client frame for kills.
+	* Unreliable so lost shots don't hold back other reliable traffic, batches are resent until acked instead.
+	*/
+	UFUNCTION(Server, Unreliable)
+	void ServerReportShots(const FServerSideRewindShotBatch& Batch);
+
+	/** Client remote procedure call acking the latest shot batch and the 32 before it */
+	UFUNCTION(Client, Unreliable)
+	void ClientAckShots(uint16 LatestSequence, uint32 AckBits);
+
+	/** Checks reported shot for kill depending on the server side rewind settings of the game mode */
+	void HandleReportedShot(const FServerSideRewindFrameTime& Time, FVector Start, FVector End);
 
 	/**
 	* Methods to check for valid kill.
-	* Called from ServerKillButtonPressed method.
+	* Called from HandleReportedShot method.
 	*/
 	void CheckForKill(FVector Start, FVector End);
-	void CheckForKillServerSideRewind(AFirstPersonCharacter* HitCharacter, float Time, FVector Start, FVector End);
-
-	/** Multicast remote procedure call to enable ragdoll when character is killed */
-	UFUNCTION(NetMulticast, Reliable)
-	void MulticastRagdoll();
+	void CheckForKillServerSideRewind(const FServerSideRewindFrameTime& Time, FVector Start, FVector End);
 };
@@ -1,202 +1,254 @@
 #include "ServerSideRewindComponent.h"
+#include "ServerSideRewind/ServerSideRewind.h"
 #include "Components/BoxComponent.h"
-#include "ServerSideRewind/Character/FirstPersonCharacter.h"
-#include "Kismet/GameplayStatics.h"
+#include "Engine/SkeletalMeshSocket.h"
+#include "GameFramework/CharacterMovementComponent.h"
 #include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerState.h"
+#include "ServerSideRewind/Character/FirstPersonCharacter.h"
+#include "ServerSideRewind/Subsystems/ServerSideRewindSubsystem.h"
+#include "ServerSideRewindHitBoxPool.h"
 
 
+static TAutoConsoleVariable<int32> CVarServerSideRewindHitTestMode(
+	TEXT("ServerSideRewind.HitTestMode"), 1,
+	TEXT("How rewound hitboxes are tested.\n")
+	TEXT("0: Move hitbox components and perform a physics line trace\n")
+	TEXT("1: Analytic ray vs oriented box test on the snapshot data (default)"));
+
 UServerSideRewindComponent::UServerSideRewindComponent()
 {
-	PrimaryComponentTick.bCanEverTick = true;
+	/** Snapshots of all characters are recorded by UServerSideRewindSubsystem */
+	PrimaryComponentTick.bCanEverTick = false;
 }
 
 void UServerSideRewindComponent::BeginPlay()
 {
 	Super::BeginPlay();
-}
 
-void UServerSideRewindComponent::TickComponent(float DeltaTime, ELevelTick TickType,
-	FActorComponentTickFunction* ThisTickFunction)
-{
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	/** Register owning character to be recorded (server only) */
+	Character = Character == nullptr ? Cast<AFirstPersonCharacter>(GetOwner()) : Character;
+	if (Character == nullptr || !Character->HasAuthority()) { return; }
+
+	ServerSideRewindSubsystem = GetWorld()->GetSubsystem<UServerSideRewindSubsystem>();
+	if (ServerSideRewindSubsystem == nullptr) { return; }
 
-	SaveServerSideRewindSnapshot();
+	ServerSideRewindSlot = ServerSideRewindSubsystem->RegisterCharacter(Character);
 }
 
-void UServerSideRewindComponent::TakeServerSideRewindSnapshot(AFirstPersonCharacter* TargetCharacter, 
-	FServerSideRewindSnapshot& Snapshot)
+void UServerSideRewindComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	/** Get game state if nullptr, otherwise use the member variable */
-	GameState = GameState == nullptr ? UGameplayStatics::GetGameState(this) : GameState;
-
-	if (TargetCharacter == nullptr || GameState == nullptr) { return; }
-
-	Snapshot.Character = TargetCharacter;
-	Snapshot.Time = GameState->GetServerWorldTimeSeconds();
-
-	for (auto& HitBox : TargetCharacter->HitBoxes)
+	if (ServerSideRewindSubsystem != nullptr && ServerSideRewindSlot != INDEX_NONE)
 	{
-		if (HitBox.Value == nullptr) { break; }
-
-		FHitBoxSnapshot HitBoxSnapshot;
-		HitBoxSnapshot.Location = HitBox.Value->GetComponentLocation();
-		HitBoxSnapshot.Rotation = HitBox.Value->GetComponentRotation();
-		HitBoxSnapshot.Extent = HitBox.Value->GetScaledBoxExtent();
-		Snapshot.HitBoxSnapshots.Add(HitBox.Key, HitBoxSnapshot);
+		ServerSideRewindSubsystem->UnregisterCharacter(ServerSideRewindSlot);
+		ServerSideRewindSlot = INDEX_NONE;
 	}
+
+	Super::EndPlay(EndPlayReason);
 }
 
-void UServerSideRewindComponent::SaveServerSideRewindSnapshot()
+void UServerSideRewindComponent::QueueKillCheck(const FServerSideRewindFrameTime& Time, FVector Start, FVector End,
+	int32 MaxHits)
 {
-	/** Try getting owning character */
-	Character = Character == nullptr ? Cast<AFirstPersonCharacter>(GetOwner()) : Character;
-	if (Character == nullptr || !Character->HasAuthority()) { return; }
-
-	/** Handle first and second snapshot */
-	if (ServerSideRewindSnapshotHistory.Num() <= 1)
+	if (ServerSideRewindSubsystem == nullptr || GetWorld()->GetGameState() == nullptr) { return; }
+
+	/** The client reports the hit time, only trust it as far as the latency of its connection explains */
+	const float FrameRate = ServerSideRewind::GetFrameRate();
+	const FServerSideRewindFrameTime ServerTime =
+		ServerSideRewind::ToFrameTime(GetWorld()->GetGameState()->GetServerWorldTimeSeconds());
+	float Rewind = ServerTime.FramesSince(Time) / FrameRate;
+	FServerSideRewindFrameTime HitTime = Time;
+	switch (LatencyEstimator.CheckRewind(ServerSideRewindSubsystem->GetMaxRewindTime(), Rewind))
 	{
-		/** Take snapshot and save to snapshot history */
-		FServerSideRewindSnapshot ServerSideRewindSnapshot;
-		TakeServerSideRewindSnapshot(Character, ServerSideRewindSnapshot);
-		ServerSideRewindSnapshotHistory.AddHead(ServerSideRewindSnapshot);
-
-		/** Show snapshot on screen */
-		//ShowServerSideRewindSnapshot(ServerSideRewindSnapshot);
+	case EServerSideRewindTimeCheck::Accepted:
+		break;
+	case EServerSideRewindTimeCheck::Clamped:
+		HitTime = ServerTime.AddFrames(-Rewind * FrameRate);
+		UE_LOG(LogServerSideRewind, Verbose, TEXT("Shot at frame %d clamped to frame %d (received at frame %d)"),
+			Time.Frame, HitTime.Frame, ServerTime.Frame);
+		INC_DWORD_STAT(STAT_ServerSideRewindShotsClamped);
+		CSV_CUSTOM_STAT(ServerSideRewind, ShotsClamped, 1, ECsvCustomStatOp::Accumulate);
+		break;
+	case EServerSideRewindTimeCheck::Rejected:
+		UE_LOG(LogServerSideRewind, Verbose, TEXT("Shot at frame %d rejected (received at frame %d)"), Time.Frame,
+			ServerTime.Frame);
+		INC_DWORD_STAT(STAT_ServerSideRewindShotsImplausible);
+		CSV_CUSTOM_STAT(ServerSideRewind, ShotsImplausible, 1, ECsvCustomStatOp::Accumulate);
+		return;
 	}
-	/** Handle all other snapshots */
-	else
-	{
-		/** Total stored time in snapshot history */
-		float SnapshotHistoryLength = ServerSideRewindSnapshotHistory.GetHead()->
-			GetValue().Time - ServerSideRewindSnapshotHistory.GetTail()->GetValue().Time;
 
-		/** Remove snapshots older than MaxRewindTime */
-		while (SnapshotHistoryLength > MaxRewindTime)
-		{
-			ServerSideRewindSnapshotHistory.RemoveNode(ServerSideRewindSnapshotHistory.GetTail());
-			SnapshotHistoryLength = ServerSideRewindSnapshotHistory.GetHead()-> GetValue().Time - 
-				ServerSideRewindSnapshotHistory.GetTail()->GetValue().Time;
-		}
+	ServerSideRewindSubsystem->QueueShot(ServerSideRewindSlot, HitTime, Start, End, MaxHits);
+}
 
-		/** Take snapshot and save to snapshot history */
-		FServerSideRewindSnapshot ServerSideRewindSnapshot;
-		TakeServerSideRewindSnapshot(Character, ServerSideRewindSnapshot);
-		ServerSideRewindSnapshotHistory.AddHead(ServerSideRewindSnapshot);
+bool UServerSideRewindComponent::SweepForHit(const FServerSideRewindFrameTime& StartTime,
+	const FServerSideRewindFrameTime& EndTime, FVector Start, FVector End, float Radius,
+	FServerSideRewindSweepResult& OutResult)
+{
+	OutResult = FServerSideRewindSweepResult();
+	if (ServerSideRewindSubsystem == nullptr) { return false; }
 
-		/** Show snapshot on screen */
-		//ShowServerSideRewindSnapshot(ServerSideRewindSnapshot);
-	}
+	return ServerSideRewindSubsystem->SweepSphere(ServerSideRewindSlot, StartTime, EndTime, Start, End, Radius,
+		OutResult);
 }
 
-void UServerSideRewindComponent::ShowServerSideRewindSnapshot(const FServerSideRewindSnapshot& Snapshot)
+void UServerSideRewindComponent::UpdateRoundTripTime()
 {
-	/** Draw every hitbox to screen */
-	for (auto& HitBox : Snapshot.HitBoxSnapshots)
-	{
-		DrawDebugBox(GetWorld(), HitBox.Value.Location, HitBox.Value.Extent,
-			FQuat(HitBox.Value.Rotation), FColor::Red, false, MaxRewindTime);
-	}
+	const APlayerState* PlayerState = Character != nullptr ? Character->GetPlayerState() : nullptr;
+	if (PlayerState == nullptr) { return; }
+
+	LatencyEstimator.AddRoundTripSample(PlayerState->GetPingInMilliseconds() / 1000.0f);
+
+	/**
+	* Other characters are seen as of their last replicated update (at worst MinNetUpdateFrequency apart)
+	* and smoothed towards it, all characters share the settings of the owning one
+	*/
+	const UCharacterMovementComponent* Movement = Character->GetCharacterMovement();
+	const float MinNetUpdateFrequency = Character->MinNetUpdateFrequency;
+	const float NetUpdateInterval = MinNetUpdateFrequency > 0.0f ? 1.0f / MinNetUpdateFrequency : 0.0f;
+	const float SmoothingTime = Movement != nullptr ? Movement->NetworkSimulatedSmoothLocationTime : 0.0f;
+	LatencyEstimator.SetInterpolationDelay(NetUpdateInterval + SmoothingTime);
 }
 
-FServerSideRewindSnapshot UServerSideRewindComponent::FindSnapshotToCheck(
-	AFirstPersonCharacter* TargetCharacter, float Time)
+void UServerSideRewindComponent::TakeServerSideRewindSnapshot(AFirstPersonCharacter* TargetCharacter,
+	const FServerSideRewindFrameTime& Time, FServerSideRewindSnapshot& Snapshot)
 {
-	/** Checking for nullptr */
-	if (TargetCharacter == nullptr || TargetCharacter->GetServerSideRewindComponent() == nullptr ||
-		TargetCharacter->GetServerSideRewindComponent()->ServerSideRewindSnapshotHistory.GetHead() == nullptr ||
-		TargetCharacter->GetServerSideRewindComponent()->ServerSideRewindSnapshotHistory.GetTail() == nullptr)
+	Snapshot.NumHitBoxes = 0;
+	if (TargetCharacter == nullptr) { return; }
+
+	Snapshot.Time = Time;
+	Snapshot.Bounds.Init();
+	Snapshot.bProxy = false;
+
+	/** Stop at the first missing hitbox */
+	int32 NumHitBoxes = 0;
+	while (NumHitBoxes < TargetCharacter->HitBoxes.Num() && TargetCharacter->HitBoxes[NumHitBoxes] != nullptr)
 	{
-		return FServerSideRewindSnapshot();
+		const UBoxComponent* HitBox = TargetCharacter->HitBoxes[NumHitBoxes];
+		Snapshot.HitBoxLocations[NumHitBoxes] = HitBox->GetComponentLocation();
+		Snapshot.HitBoxRotations[NumHitBoxes] = HitBox->GetComponentQuat();
+		Snapshot.HitBoxExtents[NumHitBoxes] = HitBox->GetScaledBoxExtent();
+		Snapshot.Bounds += HitBox->Bounds.GetBox();
+		NumHitBoxes++;
 	}
+	Snapshot.NumHitBoxes = NumHitBoxes;
+}
 
-	/** Get snapshot history */
-	const TDoubleLinkedList<FServerSideRewindSnapshot>& History = TargetCharacter->
-		GetServerSideRewindComponent()->ServerSideRewindSnapshotHistory;
-
-	/** Get oldest and latest times in history */
-	const float OldestTime = History.GetTail()->GetValue().Time;
-	const float LatestTime = History.GetHead()->GetValue().Time;
+bool UServerSideRewindComponent::BuildHitBoxLayout(AFirstPersonCharacter* TargetCharacter,
+	FServerSideRewindHitBoxLayout& Layout)
+{
+	Layout.NumHitBoxes = 0;
+	if (TargetCharacter == nullptr || TargetCharacter->GetMesh() == nullptr) { return false; }
 
-	UE_LOG(LogTemp, Warning, TEXT("Oldest: %f"), OldestTime);
-	UE_LOG(LogTemp, Warning, TEXT("Latest: %f"), LatestTime);
-	UE_LOG(LogTemp, Warning, TEXT("Hit: %f"), Time);
+	const USkeletalMeshComponent* Mesh = TargetCharacter->GetMesh();
+	Layout.MeshTransform = Mesh->GetRelativeTransform();
+	Layout.BoundsMargin = 0.0;
 
-	/** Too far back in the past */
-	if (OldestTime > Time) { return FServerSideRewindSnapshot(); }
+	/** Stop at the first missing hitbox (same as taking a snapshot) */
+	int32 NumHitBoxes = 0;
+	while (NumHitBoxes < TargetCharacter->HitBoxes.Num() && TargetCharacter->HitBoxes[NumHitBoxes] != nullptr)
+	{
+		const UBoxComponent* HitBox = TargetCharacter->HitBoxes[NumHitBoxes];
+		if (HitBox->GetAttachParent() != Mesh) { return false; }
 
-	/** Exact match between hit time and oldest time, simply return oldest snapshot */
-	if (OldestTime == Time) { return History.GetTail()->GetValue(); }
+		/** Hitboxes are attached to sockets or bones, sockets add their own offset to the bone */
+		FName BoneName = HitBox->GetAttachSocketName();
+		FTransform HitBoxTransform = HitBox->GetRelativeTransform();
+		if (const USkeletalMeshSocket* Socket = Mesh->GetSocketByName(BoneName))
+		{
+			BoneName = Socket->BoneName;
+			HitBoxTransform = HitBoxTransform * Socket->GetSocketLocalTransform();
+		}
 
-	/** Hit time newer than or equal to latest snapshot, simply return latest snapshot */
-	if (LatestTime <= Time) { return History.GetHead()->GetValue(); }
+		const int32 BoneIndex = Mesh->GetBoneIndex(BoneName);
+		if (BoneIndex == INDEX_NONE) { return false; }
+
+		/** Extents are scaled up front, the transform only has to place and rotate the box */
+		Layout.BoneIndices[NumHitBoxes] = BoneIndex;
+		Layout.HitBoxExtents[NumHitBoxes] = HitBox->GetScaledBoxExtent();
+		HitBoxTransform.SetScale3D(FVector::OneVector);
+		Layout.HitBoxTransforms[NumHitBoxes] = HitBoxTransform;
+		Layout.BoundsMargin = FMath::Max(Layout.BoundsMargin,
+			HitBoxTransform.GetLocation().Size() + Layout.HitBoxExtents[NumHitBoxes].Size());
+		NumHitBoxes++;
+	}
+	Layout.NumHitBoxes = NumHitBoxes;
+	return NumHitBoxes > 0;
+}
 
-	TDoubleLinkedList<FServerSideRewindSnapshot>::TDoubleLinkedListNode* CurrentNode = History.GetHead();
+void UServerSideRewindComponent::ShowServerSideRewindSnapshot(const FServerSideRewindSnapshot& Snapshot)
+{
+	const float Duration = ServerSideRewindSubsystem != nullptr ? ServerSideRewindSubsystem->GetMaxRewindTime() : 3.0f;
 
-	/** Find first snapshot that is equal to or older than hit time and return it */
-	while (CurrentNode->GetValue().Time > Time)
+	/** Draw every hitbox to screen */
+	for (int32 Index = 0; Index < Snapshot.NumHitBoxes; Index++)
 	{
-		if (CurrentNode->GetNextNode() == nullptr) { break; }
-		CurrentNode = CurrentNode->GetNextNode();
+		DrawDebugBox(GetWorld(), Snapshot.HitBoxLocations[Index], Snapshot.HitBoxExtents[Index],
+			Snapshot.HitBoxRotations[Index], FColor::Red, false, Duration);
 	}
-	return CurrentNode->GetValue();
 }
 
-void UServerSideRewindComponent::MoveHitBoxesToSnapshot(AFirstPersonCharacter* TargetCharacter, 
-	const FServerSideRewindSnapshot& Snapshot)
+/** Converts snapshot to the core snapshot, locations relative to Origin */
+static void ToCoreSnapshot(const FServerSideRewindSnapshot& Snapshot, const FVector& Origin,
+	ServerSideRewindCore::FHitBoxSnapshot& OutSnapshot)
 {
-	if (TargetCharacter == nullptr) { return; }
+	OutSnapshot.Time = Snapshot.Time;
+	OutSnapshot.NumHitBoxes = Snapshot.NumHitBoxes;
+	OutSnapshot.bProxy = Snapshot.bProxy;
 
-	for (auto& HitBox : TargetCharacter->HitBoxes)
+	for (int32 Index = 0; Index < Snapshot.NumHitBoxes; Index++)
 	{
-		if (HitBox.Value == nullptr || !Snapshot.HitBoxSnapshots.Contains(HitBox.Key)) { break; }
-
-		HitBox.Value->SetWorldLocation(Snapshot.HitBoxSnapshots[HitBox.Key].Location);
-		HitBox.Value->SetWorldRotation(Snapshot.HitBoxSnapshots[HitBox.Key].Rotation);
-		HitBox.Value->SetBoxExtent(Snapshot.HitBoxSnapshots[HitBox.Key].Extent);
+		OutSnapshot.Locations[Index] = ServerSideRewind::ToCore(FVector3f(Snapshot.HitBoxLocations[Index] - Origin));
+		OutSnapshot.Rotations[Index] = ServerSideRewind::ToCore(FQuat4f(Snapshot.HitBoxRotations[Index]));
+		OutSnapshot.Extents[Index] = ServerSideRewind::ToCore(FVector3f(Snapshot.HitBoxExtents[Index]));
 	}
 }
 
-bool UServerSideRewindComponent::CheckForKill(AFirstPersonCharacter* HitCharacter,
-	float Time, FVector Start, FVector End)
+void UServerSideRewindComponent::InterpolateSnapshots(const FServerSideRewindSnapshotPair& SnapshotPair,
+	FServerSideRewindSnapshot& Snapshot)
 {
-	if (HitCharacter == nullptr) { return false; }
-
-	/** Save current snapshot to reset hitboxes after checking for kill */
-	FServerSideRewindSnapshot CurrentSnapshot;
-	TakeServerSideRewindSnapshot(HitCharacter, CurrentSnapshot);
-
-	/** Find snapshot to check */
-	FServerSideRewindSnapshot SnapshotToCheck = FindSnapshotToCheck(HitCharacter, Time);
-
-	/** Move hitboxes to their position at the time of the snapshot to check */
-	MoveHitBoxesToSnapshot(HitCharacter, SnapshotToCheck);
-
-	/** Enable collision on hitboxes */
-	for (auto& HitBox : HitCharacter->HitBoxes)
+	if (!SnapshotPair.IsValid()) { return; }
+
+	const FServerSideRewindSnapshot& Older = *SnapshotPair.Older;
+	const FServerSideRewindSnapshot& Newer = *SnapshotPair.Newer;
+
+	/** Interpolation itself lives in the core, locations are made relative to the character to stay precise in float */
+	const FVector Origin = Older.Bounds.IsValid ? Older.Bounds.GetCenter() : FVector::ZeroVector;
+	ServerSideRewindCore::FHitBoxSnapshot CoreOlder;
+	ServerSideRewindCore::FHitBoxSnapshot CoreNewer;
+	ServerSideRewindCore::FHitBoxSnapshot CoreSnapshot;
+	ToCoreSnapshot(Older, Origin, CoreOlder);
+	ToCoreSnapshot(Newer, Origin, CoreNewer);
+	ServerSideRewindCore::InterpolateSnapshots(CoreOlder, CoreNewer, SnapshotPair.Alpha, CoreSnapshot);
+
+	Snapshot.Time = CoreSnapshot.Time;
+	Snapshot.NumHitBoxes = CoreSnapshot.NumHitBoxes;
+	Snapshot.bProxy = CoreSnapshot.bProxy;
+	for (int32 Index = 0; Index < Snapshot.NumHitBoxes; Index++)
 	{
-		if (HitBox.Value != nullptr)
-		{
-			HitBox.Value->SetCollisionEnabled(ECollisionEnabled::QueryAndPhysics);
-		}
+		Snapshot.HitBoxLocations[Index] = Origin + FVector(ServerSideRewind::FromCore(CoreSnapshot.Locations[Index]));
+		Snapshot.HitBoxRotations[Index] = FQuat(ServerSideRewind::FromCore(CoreSnapshot.Rotations[Index]));
+		Snapshot.HitBoxExtents[Index] = FVector(ServerSideRewind::FromCore(CoreSnapshot.Extents[Index]));
 	}
 
-	/** Perform a line trace to check kill */
-	FHitResult HitResult;
-	bool Hit = GetWorld()->LineTraceSingleByChannel(HitResult, Start, End, 
-		ECollisionChannel::ECC_GameTraceChannel1);
+	/** Bounds aren't part of the core snapshot, the closer snapshot is used as is if it couldn't be interpolated */
+	if (Older.bProxy != Newer.bProxy) { Snapshot.Bounds = SnapshotPair.Alpha < 0.5f ? Older.Bounds : Newer.Bounds; }
+	else { Snapshot.Bounds = Older.Bounds + Newer.Bounds; }
+}
+
+bool UServerSideRewindComponent::UseAnalyticHitTest()
+{
+	return CVarServerSideRewindHitTestMode.GetValueOnGameThread() != 0;
+}
 
-	/** Reset hitbox positions */
-	MoveHitBoxesToSnapshot(HitCharacter, CurrentSnapshot);
+bool UServerSideRewindComponent::TraceRewoundHitBoxes(AFirstPersonCharacter* HitCharacter,
+	const FServerSideRewindHitBoxPool& HitBoxPool, const FVector& Start, const FVector& End,
+	FServerSideRewindHitResult& HitResult)
+{
+	if (!HitBoxPool.Trace(Start, End, HitResult)) { return false; }
 
-	/** Disable collision on hitboxes */
-	for (auto& HitBox : HitCharacter->HitBoxes)
+	if (HitCharacter != nullptr && HitCharacter->HitBoxBoneNames.IsValidIndex(HitResult.HitBoxIndex))
 	{
-		if (HitBox.Value != nullptr)
-		{
-			HitBox.Value->SetCollisionEnabled(ECollisionEnabled::NoCollision);
-		}
+		HitResult.BoneName = HitCharacter->HitBoxBoneNames[HitResult.HitBoxIndex];
 	}
-
-	/** Return result of line trace */
-	return Hit;
+	return true;
 }
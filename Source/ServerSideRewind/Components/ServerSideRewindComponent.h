@@ -2,47 +2,96 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "ServerSideRewindFrameTime.h"
+#include "ServerSideRewindHitTest.h"
+#include "ServerSideRewindLatency.h"
 #include "ServerSideRewindComponent.generated.h"
 
 
 class AFirstPersonCharacter;
+class UServerSideRewindSubsystem;
+struct FServerSideRewindHitBoxPool;
 
 
 /**
-* Struct used to save snapshots of a single hitbox.
-* Helper struct for FServerSideRewindSnapshot.
+* Struct used to save snapshots of a character.
+* Hitbox data is stored in parallel fixed-size arrays indexed by the character's hitbox index
+* (see AFirstPersonCharacter::HitBoxes), so a snapshot is one flat block without any allocations.
+* Holds no UObject references, the character is known by the slot the snapshot was taken or decoded for,
+* so snapshots can be copied around freely and are never visited by the garbage collector.
 */
 USTRUCT(BlueprintType)
-struct FHitBoxSnapshot
+struct FServerSideRewindSnapshot
 {
 	GENERATED_BODY()
 
-	UPROPERTY()
-	FVector Location;
+	/** Server frame the snapshot was taken at (with a fraction if it's interpolated between two frames) */
+	FServerSideRewindFrameTime Time;
 
+	/** Amount of valid entries in the hitbox arrays */
 	UPROPERTY()
-	FRotator Rotation;
+	int32 NumHitBoxes = 0;
 
-	UPROPERTY()
-	FVector Extent;
+	/** Aggregate bounds of all hitboxes (used for broadphase culling) */
+	FBox Bounds = FBox(ForceInit);
+
+	/** Single box approximating the capsule instead of the hitboxes (characters recorded at the lowest LOD) */
+	bool bProxy = false;
+
+	FVector HitBoxLocations[ServerSideRewind::MaxHitBoxes];
+	FQuat HitBoxRotations[ServerSideRewind::MaxHitBoxes];
+	FVector HitBoxExtents[ServerSideRewind::MaxHitBoxes];
 };
 
 /**
-* Struct used to save snapshots of a character.
+* Constant hitbox setup shared by all characters of a class.
+* Every hitbox is attached to a bone of the mesh with a fixed offset, so its world transform can be
+* reconstructed from the component space transform of that bone and the actor transform.
 */
-USTRUCT(BlueprintType)
-struct FServerSideRewindSnapshot
+struct FServerSideRewindHitBoxLayout
 {
-	GENERATED_BODY()
+	/** Transform of the mesh relative to the actor */
+	FTransform MeshTransform;
 
-	UPROPERTY()
-	float Time;
+	int32 NumHitBoxes = 0;
 
-	UPROPERTY()
-	AFirstPersonCharacter* Character;
+	/** Index of the bone every hitbox is attached to */
+	int32 BoneIndices[ServerSideRewind::MaxHitBoxes];
 
-	UPROPERTY()
-	TMap<FName, FHitBoxSnapshot> HitBoxSnapshots;
+	/** Transform of every hitbox relative to its bone */
+	FTransform HitBoxTransforms[ServerSideRewind::MaxHitBoxes];
+
+	FVector HitBoxExtents[ServerSideRewind::MaxHitBoxes];
+
+	/** Max distance a hitbox reaches beyond its bone (used for growing the mesh bounds to contain all hitboxes) */
+	double BoundsMargin = 0.0;
+};
+
+/**
+* Two snapshots bracketing a hit time, Alpha being the interpolation factor between them.
+* Points to snapshots decoded from the frame history by the caller, which has to keep them alive.
+*/
+struct FServerSideRewindSnapshotPair
+{
+	const FServerSideRewindSnapshot* Older = nullptr;
+	const FServerSideRewindSnapshot* Newer = nullptr;
+	float Alpha = 0.0f;
+
+	FORCEINLINE bool IsValid() const { return Older != nullptr && Newer != nullptr; }
+};
+
+/**
+* First character hit by a sphere swept through the rewound history, e.g. a projectile over its flight.
+*/
+struct FServerSideRewindSweepResult
+{
+	AFirstPersonCharacter* HitCharacter = nullptr;
+
+	/** Hit hitbox and bone, Distance along the path and ImpactPoint being the center of the sphere at the impact */
+	FServerSideRewindHitResult HitResult;
+
+	/** Time of impact */
+	FServerSideRewindFrameTime Time;
 };
 
 
@@ -54,47 +103,71 @@ class SERVERSIDEREWIND_API UServerSideRewindComponent : public UActorComponent
 public:
 	UServerSideRewindComponent();
 	friend class AFirstPersonCharacter;
-	virtual void TickComponent(float DeltaTime, ELevelTick TickType,
-		FActorComponentTickFunction* ThisTickFunction) override;
 
-	/** Server side rewind snapshots going back as far as MaxRewindTime allows */
-	TDoubleLinkedList<FServerSideRewindSnapshot> ServerSideRewindSnapshotHistory;
+	/** Takes snapshot of the current hitboxes of the specified character */
+	static void TakeServerSideRewindSnapshot(AFirstPersonCharacter* TargetCharacter,
+		const FServerSideRewindFrameTime& Time, FServerSideRewindSnapshot& Snapshot);
+
+	/**
+	* Builds the hitbox layout of the specified character from the current setup of its hitbox components.
+	* Returns false if a hitbox isn't attached to a bone of the mesh.
+	*/
+	static bool BuildHitBoxLayout(AFirstPersonCharacter* TargetCharacter, FServerSideRewindHitBoxLayout& Layout);
+
+	/** Interpolates hitbox locations and rotations between the two snapshots of the pair */
+	static void InterpolateSnapshots(const FServerSideRewindSnapshotPair& SnapshotPair,
+		FServerSideRewindSnapshot& Snapshot);
+
+	/** Performs a physics line trace against the hitbox pool placed at the rewound hitboxes of the character */
+	static bool TraceRewoundHitBoxes(AFirstPersonCharacter* HitCharacter, const FServerSideRewindHitBoxPool& HitBoxPool,
+		const FVector& Start, const FVector& End, FServerSideRewindHitResult& HitResult);
+
+	/** Whether rewound hitboxes are tested analytically or with a physics line trace (ServerSideRewind.HitTestMode) */
+	static bool UseAnalyticHitTest();
+
+	/** Slot of the owning character in the server side rewind frame history (server only) */
+	FORCEINLINE int32 GetServerSideRewindSlot() const { return ServerSideRewindSlot; }
+
+	/**
+	* Queues kill check using server side rewind for a shot fired by the owning character.
+	* All queued shots are checked together once per frame by the subsystem.
+	* Penetrating shots kill up to MaxHits characters along their line.
+	*/
+	void QueueKillCheck(const FServerSideRewindFrameTime& Time, FVector Start, FVector End, int32 MaxHits = 1);
+
+	/**
+	* Finds the first character hit by a sphere fired by the owning character, moving from Start at StartTime
+	* to End at EndTime, against the hitboxes as they moved through the history over that time.
+	* Validates projectiles without spawning and simulating them on the server.
+	* See UServerSideRewindSubsystem::SweepSphere.
+	*/
+	bool SweepForHit(const FServerSideRewindFrameTime& StartTime, const FServerSideRewindFrameTime& EndTime,
+		FVector Start, FVector End, float Radius, FServerSideRewindSweepResult& OutResult);
+
+	/** Samples the round trip time of the owning player's connection (server only, once per received shot batch) */
+	void UpdateRoundTripTime();
+
+	FORCEINLINE const FServerSideRewindLatencyEstimator& GetLatencyEstimator() const { return LatencyEstimator; }
 
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 private:
 	/** Character owning this component */
 	UPROPERTY()
 	AFirstPersonCharacter* Character;
 
-	/** Game state (used for getting server time) */
+	/** Subsystem recording the snapshot history of all characters */
 	UPROPERTY()
-	AGameStateBase* GameState;
+	UServerSideRewindSubsystem* ServerSideRewindSubsystem;
 
-	/** Max amount of seconds to go back in time */
-	float MaxRewindTime = 3.0f;
+	/** Slot of the owning character in the frame history */
+	int32 ServerSideRewindSlot = INDEX_NONE;
 
-	/** Takes snapshot of the current character state of the specified character */
-	void TakeServerSideRewindSnapshot(AFirstPersonCharacter* TargetCharacter, 
-		FServerSideRewindSnapshot& Snapshot);
-
-	/** Saves snapshot of the current character state */
-	void SaveServerSideRewindSnapshot();
+	/** Latency of the owning player's connection, bounds how far back its shots can rewind */
+	FServerSideRewindLatencyEstimator LatencyEstimator;
 
 	/** Draws hitboxes (Debug only) */
 	void ShowServerSideRewindSnapshot(const FServerSideRewindSnapshot& Snapshot);
-
-	/** Helper function to find the snapshot to check (closest one to the hit time) */
-	FServerSideRewindSnapshot FindSnapshotToCheck(AFirstPersonCharacter* TargetCharacter, float Time);
-
-	/**
-	* Helper function used for moving hitboxes to position of snapshot to check for kill
-	* and then move them back to their original position.
-	*/
-	void MoveHitBoxesToSnapshot(AFirstPersonCharacter* TargetCharacter, 
-		const FServerSideRewindSnapshot& Snapshot);
-
-	/** Checks for kill using server side rewind */
-	bool CheckForKill(AFirstPersonCharacter* HitCharacter, float Time, FVector Start, FVector End);
 };
@@ -0,0 +1,65 @@
+#include "ServerSideRewindCompression.h"
+
+
+void ServerSideRewind::QuantizePosition(const FVector& Position, const FVector& RootLocation, int16 OutQuantized[3])
+{
+	const FVector Relative = (Position - RootLocation) / PositionQuantum;
+	for (int32 Axis = 0; Axis < 3; Axis++)
+	{
+		OutQuantized[Axis] = static_cast<int16>(FMath::Clamp(FMath::RoundToInt(Relative[Axis]),
+			static_cast<int32>(MIN_int16), static_cast<int32>(MAX_int16)));
+	}
+}
+
+FVector ServerSideRewind::DequantizePosition(const int32 Quantized[3], const FVector& RootLocation)
+{
+	return RootLocation + FVector(Quantized[0], Quantized[1], Quantized[2]) * PositionQuantum;
+}
+
+void ServerSideRewind::PackRotation(const FQuat& Rotation, uint16 OutPacked[3])
+{
+	const FQuat Normalized = Rotation.GetNormalized();
+	const double Components[4] = { Normalized.X, Normalized.Y, Normalized.Z, Normalized.W };
+
+	/** Find largest component, the quaternion is negated if it's negative (q and -q are the same rotation) */
+	int32 Largest = 0;
+	for (int32 Index = 1; Index < 4; Index++)
+	{
+		if (FMath::Abs(Components[Index]) > FMath::Abs(Components[Largest])) { Largest = Index; }
+	}
+	const double Sign = Components[Largest] < 0.0 ? -1.0 : 1.0;
+
+	/** Remaining components are within +-1/sqrt(2), map them to 15 bits */
+	int32 Packed = 0;
+	for (int32 Index = 0; Index < 4; Index++)
+	{
+		if (Index == Largest) { continue; }
+
+		const double Normalized01 = (Components[Index] * Sign * UE_SQRT_2 + 1.0) * 0.5;
+		OutPacked[Packed++] = static_cast<uint16>(FMath::Clamp(FMath::RoundToInt(Normalized01 * 32767.0), 0, 32767));
+	}
+
+	/** Store index of the largest component in the top bits of the first two words */
+	OutPacked[0] |= static_cast<uint16>((Largest & 1) << 15);
+	OutPacked[1] |= static_cast<uint16>(((Largest >> 1) & 1) << 15);
+}
+
+FQuat ServerSideRewind::UnpackRotation(const uint16 Packed[3])
+{
+	const int32 Largest = (Packed[0] >> 15) | ((Packed[1] >> 15) << 1);
+
+	double Components[4];
+	double SumOfSquares = 0.0;
+	int32 Unpacked = 0;
+	for (int32 Index = 0; Index < 4; Index++)
+	{
+		if (Index == Largest) { continue; }
+
+		const double Normalized01 = (Packed[Unpacked++] & 0x7FFF) / 32767.0;
+		Components[Index] = (Normalized01 * 2.0 - 1.0) / UE_SQRT_2;
+		SumOfSquares += Components[Index] * Components[Index];
+	}
+	Components[Largest] = FMath::Sqrt(FMath::Max(0.0, 1.0 - SumOfSquares));
+
+	return FQuat(Components[0], Components[1], Components[2], Components[3]);
+}
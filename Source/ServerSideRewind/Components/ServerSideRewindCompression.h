@@ -0,0 +1,116 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ServerSideRewindHitTest.h"
+
+
+namespace ServerSideRewind
+{
+	/** Size of a position quantization step in cm (int16 covers +-1638 cm around the actor root) */
+	constexpr float PositionQuantum = 0.05f;
+
+	/** Every n-th frame stores full positions for all characters, the ones in between store deltas */
+	constexpr int32 KeyFrameInterval = 8;
+
+	/** Quantizes position relative to the actor root (clamped to the int16 range) */
+	void QuantizePosition(const FVector& Position, const FVector& RootLocation, int16 OutQuantized[3]);
+
+	/** Restores position quantized with QuantizePosition */
+	FVector DequantizePosition(const int32 Quantized[3], const FVector& RootLocation);
+
+	/**
+	* Packs rotation using the smallest three encoding into 48 bits.
+	* The largest quaternion component is dropped and restored from the unit length,
+	* the other three are stored in the low 15 bits of the three words. The 2 bit index of the dropped one is split
+	* across the top bits of the first two words (low bit in word 0, high bit in word 1), the top bit of word 2 is 0.
+	*/
+	void PackRotation(const FQuat& Rotation, uint16 OutPacked[3]);
+
+	/** Restores rotation packed with PackRotation */
+	FQuat UnpackRotation(const uint16 Packed[3]);
+}
+
+
+/**
+* How the hitbox positions of a character are stored in a frame.
+*/
+enum class EServerSideRewindRecordEncoding : uint8
+{
+	/** Character wasn't recorded in this frame */
+	Empty,
+	/** Full quantized positions, decodable on their own */
+	Key,
+	/** Positions stored as difference to the previous frame */
+	Delta,
+	/** Hitboxes didn't move relative to the root since the previous frame, nothing is stored */
+	Unchanged,
+	/** Only the root transform is stored, decoded into a single box approximating the capsule */
+	Proxy
+};
+
+/**
+* Full quantized hitbox positions relative to the actor root.
+*/
+struct FServerSideRewindKeyPositions
+{
+	int16 Positions[ServerSideRewind::MaxHitBoxes][3];
+};
+
+/**
+* Quantized hitbox positions stored as difference to the previous frame.
+*/
+struct FServerSideRewindDeltaPositions
+{
+	int8 Positions[ServerSideRewind::MaxHitBoxes][3];
+};
+
+/**
+* Hitbox rotations in smallest three encoding.
+*/
+struct FServerSideRewindPackedRotations
+{
+	uint16 Rotations[ServerSideRewind::MaxHitBoxes][3];
+};
+
+/**
+* Compact record of a character in a frame.
+* Decoded lazily into a FServerSideRewindSnapshot when the frame is actually looked up.
+* Extents are only stored with key and proxy records, a change of the extents forces a key record.
+* Holds either hitbox world transforms relative to the actor location or, when recording bone transforms,
+* the component space transforms of the bones the hitboxes are attached to plus the actor transform.
+*/
+struct FServerSideRewindPackedRecord
+{
+	/** Location the hitbox positions are quantized relative to */
+	FVector RootLocation = FVector::ZeroVector;
+
+	/** Actor rotation in smallest three encoding (only used when recording bone transforms) */
+	uint16 RootRotation[3];
+
+	/** Aggregate bounds of all hitboxes (used for broadphase culling) */
+	FVector3f BoundsMin = FVector3f::ZeroVector;
+	FVector3f BoundsMax = FVector3f::ZeroVector;
+
+	EServerSideRewindRecordEncoding Encoding = EServerSideRewindRecordEncoding::Empty;
+
+	uint8 NumHitBoxes = 0;
+
+	/** Index of the positions in the key or delta positions of the frame (depending on the encoding) */
+	uint16 PositionIndex = 0;
+
+	/** Index of the rotations in the rotations of the frame (not used by unchanged records) */
+	uint16 RotationIndex = 0;
+
+	/** Index of the first hitbox extent in the extents of the frame (only used by key and proxy records) */
+	uint16 ExtentsIndex = 0;
+
+	FORCEINLINE bool IsEmpty() const { return Encoding == EServerSideRewindRecordEncoding::Empty; }
+	FORCEINLINE FBox GetBounds() const { return FBox(FVector(BoundsMin), FVector(BoundsMax)); }
+
+	/** Expands the bounds a bit, so converting them to float can't make them smaller than the hitboxes */
+	FORCEINLINE void SetBounds(const FBox& Bounds)
+	{
+		BoundsMin = FVector3f(Bounds.Min - FVector(1.0));
+		BoundsMax = FVector3f(Bounds.Max + FVector(1.0));
+	}
+};
@@ -0,0 +1,17 @@
+#include "ServerSideRewindFrameTime.h"
+
+
+static TAutoConsoleVariable<float> CVarServerSideRewindFrameRate(
+	TEXT("ServerSideRewind.FrameRate"), 60.0f,
+	TEXT("Frames per second of the grid the history is recorded and shots are reported on. ")
+	TEXT("Should match the server tick rate and has to be the same on server and clients (set it in DefaultEngine.ini)."));
+
+float ServerSideRewind::GetFrameRate()
+{
+	return FMath::Max(CVarServerSideRewindFrameRate.GetValueOnAnyThread(), 1.0f);
+}
+
+FServerSideRewindFrameTime ServerSideRewind::ToFrameTime(double ServerTime)
+{
+	return FServerSideRewindFrameTime::FromSeconds(ServerTime, GetFrameRate());
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ServerSideRewindCore/FrameTime.h"
+
+
+/**
+* Hit and frame times of server side rewind: a server frame number on a fixed-rate grid plus the fraction towards
+* the next frame. Unlike float seconds it stays exact however long the server runs, and frames are found by index.
+*/
+using FServerSideRewindFrameTime = ServerSideRewindCore::FFrameTime;
+
+namespace ServerSideRewind
+{
+	/** Frames per second of the frame number grid (ServerSideRewind.FrameRate, same on server and clients) */
+	SERVERSIDEREWIND_API float GetFrameRate();
+
+	/** Converts server world time in seconds to a frame time */
+	SERVERSIDEREWIND_API FServerSideRewindFrameTime ToFrameTime(double ServerTime);
+}
@@ -0,0 +1,128 @@
+#include "ServerSideRewindHitBoxPool.h"
+#include "ServerSideRewindComponent.h"
+#include "ServerSideRewind/ServerSideRewind.h"
+#include "Components/BoxComponent.h"
+
+
+bool FServerSideRewindHitBoxPool::Create(UWorld* World)
+{
+	if (World == nullptr) { return false; }
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.Name = MakeUniqueObjectName(World->PersistentLevel, AActor::StaticClass(),
+		TEXT("ServerSideRewindHitBoxPool"));
+	SpawnParameters.ObjectFlags |= RF_Transient;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	Owner = World->SpawnActor<AActor>(SpawnParameters);
+	if (Owner == nullptr) { return false; }
+
+	Owner->SetReplicates(false);
+	Owner->SetActorHiddenInGame(true);
+
+	USceneComponent* Root = NewObject<USceneComponent>(Owner, TEXT("Root"));
+	Owner->SetRootComponent(Root);
+	Root->RegisterComponent();
+
+	/**
+	* Same collision setup as the characters' hitboxes,
+	* but placed in world space so moving one doesn't move anything else
+	*/
+	HitBoxes.Reset(ServerSideRewind::MaxHitBoxes);
+	for (int32 Index = 0; Index < ServerSideRewind::MaxHitBoxes; Index++)
+	{
+		UBoxComponent* HitBox = NewObject<UBoxComponent>(Owner);
+		HitBox->SetupAttachment(Root);
+		HitBox->SetUsingAbsoluteLocation(true);
+		HitBox->SetUsingAbsoluteRotation(true);
+		HitBox->SetUsingAbsoluteScale(true);
+		HitBox->SetMobility(EComponentMobility::Movable);
+		HitBox->SetGenerateOverlapEvents(false);
+		HitBox->SetCollisionObjectType(ECollisionChannel::ECC_GameTraceChannel1);
+		HitBox->SetCollisionResponseToAllChannels(ECollisionResponse::ECR_Ignore);
+		HitBox->SetCollisionResponseToChannel(ECollisionChannel::ECC_GameTraceChannel1, ECollisionResponse::ECR_Block);
+		HitBox->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+		HitBox->RegisterComponent();
+
+		Extents[Index] = HitBox->GetUnscaledBoxExtent();
+		HitBoxes.Add(HitBox);
+	}
+	NumEnabled = 0;
+	return true;
+}
+
+void FServerSideRewindHitBoxPool::Release()
+{
+	if (IsValid(Owner)) { Owner->Destroy(); }
+
+	Owner = nullptr;
+	HitBoxes.Reset();
+	NumEnabled = 0;
+}
+
+bool FServerSideRewindHitBoxPool::MoveToSnapshot(UWorld* World, const FServerSideRewindSnapshot& Snapshot)
+{
+	if (!IsValid(Owner) && !Create(World)) { return false; }
+
+	SCOPE_CYCLE_COUNTER(STAT_ServerSideRewindMoveHitBoxes);
+
+	/** Teleport the boxes in one pass, they have no attached children and don't sweep, so only their own bodies update */
+	const int32 NumHitBoxes = FMath::Min(Snapshot.NumHitBoxes, HitBoxes.Num());
+	for (int32 Index = 0; Index < NumHitBoxes; Index++)
+	{
+		UBoxComponent* HitBox = HitBoxes[Index];
+		if (!Extents[Index].Equals(Snapshot.HitBoxExtents[Index]))
+		{
+			HitBox->SetBoxExtent(Snapshot.HitBoxExtents[Index], false);
+			Extents[Index] = Snapshot.HitBoxExtents[Index];
+		}
+		HitBox->SetWorldLocationAndRotation(Snapshot.HitBoxLocations[Index], Snapshot.HitBoxRotations[Index],
+			false, nullptr, ETeleportType::TeleportPhysics);
+	}
+
+	/** Only toggle collision on boxes the previous snapshot didn't already leave enabled */
+	for (int32 Index = NumEnabled; Index < NumHitBoxes; Index++)
+	{
+		HitBoxes[Index]->SetCollisionEnabled(ECollisionEnabled::QueryOnly);
+	}
+	for (int32 Index = NumHitBoxes; Index < NumEnabled; Index++)
+	{
+		HitBoxes[Index]->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+	NumEnabled = NumHitBoxes;
+	bProxy = Snapshot.bProxy;
+	return NumHitBoxes > 0;
+}
+
+void FServerSideRewindHitBoxPool::Disable()
+{
+	for (int32 Index = 0; Index < NumEnabled; Index++)
+	{
+		HitBoxes[Index]->SetCollisionEnabled(ECollisionEnabled::NoCollision);
+	}
+	NumEnabled = 0;
+}
+
+bool FServerSideRewindHitBoxPool::Trace(const FVector& Start, const FVector& End,
+	FServerSideRewindHitResult& HitResult) const
+{
+	HitResult = FServerSideRewindHitResult();
+	if (NumEnabled == 0) { return false; }
+
+	SCOPE_CYCLE_COUNTER(STAT_ServerSideRewindTrace);
+
+	/** Trace the bodies of the enabled boxes directly instead of the scene, keeping the closest hit */
+	const FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(ServerSideRewindHitBoxPool));
+	FHitResult TraceHitResult;
+	for (int32 Index = 0; Index < NumEnabled; Index++)
+	{
+		if (!HitBoxes[Index]->LineTraceComponent(TraceHitResult, Start, End, QueryParams)) { continue; }
+		if (HitResult.bHit && TraceHitResult.Distance >= HitResult.Distance) { continue; }
+
+		/** The proxy is placed in the first box, which doesn't make it a hit on the first hitbox */
+		HitResult.bHit = true;
+		HitResult.Distance = TraceHitResult.Distance;
+		HitResult.ImpactPoint = TraceHitResult.ImpactPoint;
+		HitResult.HitBoxIndex = bProxy ? INDEX_NONE : Index;
+	}
+	return HitResult.bHit;
+}
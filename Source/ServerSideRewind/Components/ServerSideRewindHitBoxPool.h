@@ -0,0 +1,62 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ServerSideRewindHitTest.h"
+#include "ServerSideRewindHitBoxPool.generated.h"
+
+
+class UBoxComponent;
+struct FServerSideRewindSnapshot;
+
+
+/**
+* Dedicated hitboxes the physics hit test (ServerSideRewind.HitTestMode 0) rewinds instead of the characters' own ones.
+* The boxes belong to a hidden actor spawned on first use, have collision disabled while they aren't traced against
+* and only respond to the hitbox trace channel. A snapshot is placed by teleporting the boxes without attachments,
+* so the hitboxes of the live characters are never moved and can't be left displaced.
+*/
+USTRUCT()
+struct FServerSideRewindHitBoxPool
+{
+	GENERATED_BODY()
+
+	/**
+	* Places the boxes at the hitboxes of the snapshot and enables collision on them, spawning the boxes if needed.
+	* Boxes not used by the snapshot keep collision disabled. Returns false if the boxes couldn't be spawned.
+	*/
+	bool MoveToSnapshot(UWorld* World, const FServerSideRewindSnapshot& Snapshot);
+
+	/** Disables collision on the boxes, they stay wherever the last snapshot put them */
+	void Disable();
+
+	/**
+	* Performs a physics line trace against the enabled boxes only (has to be placed by MoveToSnapshot),
+	* so nothing else in the world on the hitbox channel can block or be reported as a hit.
+	* The hitbox index of the result is the index in the snapshot, or INDEX_NONE if the snapshot is a proxy.
+	*/
+	bool Trace(const FVector& Start, const FVector& End, FServerSideRewindHitResult& HitResult) const;
+
+	/** Destroys the actor holding the boxes */
+	void Release();
+
+private:
+	/** Hidden actor owning the boxes (spawned on first use, server only) */
+	UPROPERTY()
+	AActor* Owner = nullptr;
+
+	/** One box per hitbox index of a snapshot */
+	UPROPERTY()
+	TArray<UBoxComponent*> HitBoxes;
+
+	/** Amount of boxes the last snapshot enabled */
+	int32 NumEnabled = 0;
+
+	/** Extents the boxes were last sized to, resizing recreates the physics shape so it's skipped when unchanged */
+	FVector Extents[ServerSideRewind::MaxHitBoxes];
+
+	/** Whether the last snapshot was a proxy */
+	bool bProxy = false;
+
+	/** Spawns the actor and its boxes */
+	bool Create(UWorld* World);
+};
@@ -0,0 +1,55 @@
+#include "ServerSideRewindHitTest.h"
+#include "ServerSideRewindComponent.h"
+
+
+void FServerSideRewindHitBoxBatch::Build(const FServerSideRewindSnapshot& Snapshot, float Inflation)
+{
+	Boxes.NumHitBoxes = FMath::Min(Snapshot.NumHitBoxes, ServerSideRewind::MaxHitBoxes);
+	Boxes.bProxy = Snapshot.bProxy;
+	Origin = Boxes.NumHitBoxes > 0 ? Snapshot.HitBoxLocations[0] : FVector::ZeroVector;
+
+	for (int32 Index = 0; Index < ServerSideRewind::MaxHitBoxes; Index++)
+	{
+		if (Index < Boxes.NumHitBoxes)
+		{
+			Boxes.SetHitBox(Index, ServerSideRewind::ToCore(FVector3f(Snapshot.HitBoxLocations[Index] - Origin)),
+				ServerSideRewind::ToCore(FQuat4f(Snapshot.HitBoxRotations[Index])),
+				ServerSideRewind::ToCore(FVector3f(Snapshot.HitBoxExtents[Index] + FVector(Inflation))));
+		}
+		else { Boxes.ClearHitBox(Index); }
+	}
+}
+
+bool ServerSideRewind::LineTraceHitBoxBatch(const FServerSideRewindHitBoxBatch& Batch, const FVector& Start,
+	const FVector& End, FServerSideRewindHitResult& HitResult)
+{
+	HitResult = FServerSideRewindHitResult();
+
+	FVector Direction;
+	double Length;
+	(End - Start).ToDirectionAndLength(Direction, Length);
+	if (Length <= 0.0 || Batch.Boxes.NumHitBoxes == 0) { return false; }
+
+	/** Boxes are stored relative to the batch origin in single precision */
+	ServerSideRewindCore::FRayHit RayHit;
+	if (!ServerSideRewindCore::LineTraceBatch(Batch.Boxes, ToCore(FVector3f(Start - Batch.Origin)),
+		ToCore(FVector3f(Direction)), static_cast<float>(Length), RayHit))
+	{
+		return false;
+	}
+
+	/** Proxies are hit without a hitbox index (INDEX_NONE) */
+	HitResult.bHit = true;
+	HitResult.HitBoxIndex = RayHit.HitBoxIndex;
+	HitResult.Distance = RayHit.Distance;
+	HitResult.ImpactPoint = Start + Direction * RayHit.Distance;
+	return true;
+}
+
+bool ServerSideRewind::LineTraceSnapshot(const FServerSideRewindSnapshot& Snapshot, const FVector& Start,
+	const FVector& End, FServerSideRewindHitResult& HitResult)
+{
+	FServerSideRewindHitBoxBatch Batch;
+	Batch.Build(Snapshot);
+	return LineTraceHitBoxBatch(Batch, Start, End, HitResult);
+}
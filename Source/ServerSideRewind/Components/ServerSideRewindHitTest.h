@@ -0,0 +1,95 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ServerSideRewindCore/HitTest.h"
+
+
+struct FServerSideRewindSnapshot;
+
+
+namespace ServerSideRewind
+{
+	/** Max amount of hitboxes per character stored in a snapshot (multiple of 4 for the batched hit test) */
+	constexpr int32 MaxHitBoxes = ServerSideRewindCore::MaxHitBoxes;
+}
+
+
+/**
+* Result of a line trace against the rewound hitboxes of a character.
+*/
+struct FServerSideRewindHitResult
+{
+	bool bHit = false;
+
+	/** Index of the hit hitbox (see AFirstPersonCharacter::HitBoxes) */
+	int32 HitBoxIndex = INDEX_NONE;
+
+	/** Name of the bone the hit hitbox is attached to */
+	FName BoneName = NAME_None;
+
+	/** Distance from the start of the trace to the impact point */
+	float Distance = 0.0f;
+
+	/** Point the line entered the hit hitbox at (the start of the line if it starts inside of it) */
+	FVector ImpactPoint = FVector::ZeroVector;
+};
+
+
+/**
+* Hitboxes of a snapshot in the structure-of-arrays form used by the batched hit test.
+* Centers are stored relative to Origin, the batch itself and the hit test live in ServerSideRewindCore.
+*/
+struct FServerSideRewindHitBoxBatch
+{
+	/** World location all centers are relative to (keeps float precision far away from the world origin) */
+	FVector Origin = FVector::ZeroVector;
+
+	ServerSideRewindCore::FHitBoxBatch Boxes;
+
+	/**
+	* Converts snapshot hitboxes into batch form, unused lanes are set up to never be hit.
+	* Inflation grows every box by the radius of a swept sphere, so a line trace against the batch sweeps the sphere
+	* (slightly conservative at edges and corners, where the exact shape would be rounded).
+	*/
+	void Build(const FServerSideRewindSnapshot& Snapshot, float Inflation = 0.0f);
+};
+
+
+/**
+* Analytic hit tests performed directly on snapshot data.
+* Neither the hitbox components nor the physics scene are touched, so these are safe to call from any thread.
+*/
+namespace ServerSideRewind
+{
+	/** Conversions to and from the engine-independent core types */
+	FORCEINLINE ServerSideRewindCore::FVec3 ToCore(const FVector3f& Vector)
+	{
+		return ServerSideRewindCore::FVec3(Vector.X, Vector.Y, Vector.Z);
+	}
+
+	FORCEINLINE ServerSideRewindCore::FQuat4 ToCore(const FQuat4f& Quat)
+	{
+		return ServerSideRewindCore::FQuat4(Quat.X, Quat.Y, Quat.Z, Quat.W);
+	}
+
+	FORCEINLINE FVector3f FromCore(const ServerSideRewindCore::FVec3& Vector)
+	{
+		return FVector3f(Vector.X, Vector.Y, Vector.Z);
+	}
+
+	FORCEINLINE FQuat4f FromCore(const ServerSideRewindCore::FQuat4& Quat)
+	{
+		return FQuat4f(Quat.X, Quat.Y, Quat.Z, Quat.W);
+	}
+
+	/**
+	* Traces line against all hitboxes of the batch and returns the closest hit.
+	* Tests four boxes per pass using vector registers (see ServerSideRewindCore::LineTraceBatch).
+	*/
+	bool LineTraceHitBoxBatch(const FServerSideRewindHitBoxBatch& Batch, const FVector& Start, const FVector& End,
+		FServerSideRewindHitResult& HitResult);
+
+	/** Traces line against all hitboxes of the snapshot and returns the closest hit */
+	bool LineTraceSnapshot(const FServerSideRewindSnapshot& Snapshot, const FVector& Start, const FVector& End,
+		FServerSideRewindHitResult& HitResult);
+}
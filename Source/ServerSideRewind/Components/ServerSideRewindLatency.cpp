@@ -0,0 +1,66 @@
+#include "ServerSideRewindLatency.h"
+
+
+static TAutoConsoleVariable<float> CVarServerSideRewindRewindTolerance(
+	TEXT("ServerSideRewind.RewindTolerance"), 0.05f,
+	TEXT("Seconds a shot may rewind beyond what the measured latency of its connection explains."));
+
+static TAutoConsoleVariable<bool> CVarServerSideRewindRejectImplausibleShots(
+	TEXT("ServerSideRewind.RejectImplausibleShots"), false,
+	TEXT("Reject shots whose hit time is outside of the window the latency of their connection allows, ")
+	TEXT("instead of clamping the hit time into it."));
+
+/** Weights of a new sample in the smoothed value and in its deviation (same as RFC 6298) */
+static constexpr float SmoothingAlpha = 0.125f;
+static constexpr float DeviationBeta = 0.25f;
+
+static void AddSmoothedSample(float Sample, bool& bHasSamples, float& Smoothed, float& Deviation)
+{
+	if (!bHasSamples)
+	{
+		bHasSamples = true;
+		Smoothed = Sample;
+		Deviation = Sample * 0.5f;
+		return;
+	}
+
+	Deviation = FMath::Lerp(Deviation, FMath::Abs(Smoothed - Sample), DeviationBeta);
+	Smoothed = FMath::Lerp(Smoothed, Sample, SmoothingAlpha);
+}
+
+void FServerSideRewindLatencyEstimator::AddRoundTripSample(float RoundTripTime)
+{
+	AddSmoothedSample(FMath::Max(RoundTripTime, 0.0f), bHasRoundTrip, SmoothedRoundTripTime, RoundTripDeviation);
+}
+
+void FServerSideRewindLatencyEstimator::SetInterpolationDelay(float InInterpolationDelay)
+{
+	InterpolationDelay = FMath::Max(InInterpolationDelay, 0.0f);
+}
+
+float FServerSideRewindLatencyEstimator::GetMaxRewind(float MaxRewindTime) const
+{
+	if (!bHasRoundTrip) { return MaxRewindTime; }
+
+	const float MaxRewind = SmoothedRoundTripTime + 4.0f * RoundTripDeviation + InterpolationDelay +
+		CVarServerSideRewindRewindTolerance.GetValueOnGameThread();
+	return FMath::Min(MaxRewind, MaxRewindTime);
+}
+
+EServerSideRewindTimeCheck FServerSideRewindLatencyEstimator::CheckRewind(float MaxRewindTime, float& InOutRewind) const
+{
+	/** Hits can't happen in the future, clock drift can make it look like they did */
+	if (InOutRewind < 0.0f)
+	{
+		InOutRewind = 0.0f;
+		return EServerSideRewindTimeCheck::Clamped;
+	}
+
+	const float MaxRewind = GetMaxRewind(MaxRewindTime);
+	if (InOutRewind <= MaxRewind) { return EServerSideRewindTimeCheck::Accepted; }
+
+	if (CVarServerSideRewindRejectImplausibleShots.GetValueOnGameThread()) { return EServerSideRewindTimeCheck::Rejected; }
+
+	InOutRewind = MaxRewind;
+	return EServerSideRewindTimeCheck::Clamped;
+}
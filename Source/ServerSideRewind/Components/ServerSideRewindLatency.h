@@ -0,0 +1,58 @@
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/**
+* How the rewind of a reported hit time compares to the window the latency of its connection allows.
+*/
+enum class EServerSideRewindTimeCheck : uint8
+{
+	/** Rewind within the plausible window */
+	Accepted,
+	/** Rewind outside of the window, moved to its closest edge */
+	Clamped,
+	/** Rewind outside of the window and ServerSideRewind.RejectImplausibleShots is set */
+	Rejected
+};
+
+/**
+* Latency of one player connection, tracked on the server to bound how far its shots may rewind.
+* Keeps a smoothed round trip time and its mean deviation (the way TCP estimates retransmission timeouts)
+* and the interpolation delay the client sees other characters with on top of it.
+* Everything is measured or configured by the server, reported hit times never move the window they are checked against.
+*/
+struct FServerSideRewindLatencyEstimator
+{
+	/** Adds a round trip time measured by the connection in seconds */
+	void AddRoundTripSample(float RoundTripTime);
+
+	/**
+	* Sets the seconds the client's view of other characters lags behind what it received of them,
+	* derived from the server's replication and movement smoothing settings.
+	*/
+	void SetInterpolationDelay(float InInterpolationDelay);
+
+	/**
+	* Seconds a shot received now may rewind at most: the round trip and four of its deviations, the interpolation delay
+	* and ServerSideRewind.RewindTolerance, capped at MaxRewindTime. Without samples it's MaxRewindTime.
+	*/
+	float GetMaxRewind(float MaxRewindTime) const;
+
+	/**
+	* Checks the rewind of a shot (seconds between its reported hit time and the server time it was received at)
+	* against the plausible window and moves it inside if it's outside of it (negative rewinds are always clamped).
+	*/
+	EServerSideRewindTimeCheck CheckRewind(float MaxRewindTime, float& InOutRewind) const;
+
+	FORCEINLINE bool HasRoundTripSamples() const { return bHasRoundTrip; }
+	FORCEINLINE float GetSmoothedRoundTripTime() const { return SmoothedRoundTripTime; }
+	FORCEINLINE float GetInterpolationDelay() const { return InterpolationDelay; }
+
+private:
+	bool bHasRoundTrip = false;
+	float SmoothedRoundTripTime = 0.0f;
+	float RoundTripDeviation = 0.0f;
+
+	float InterpolationDelay = 0.0f;
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ServerSideRewindCore/RingBuffer.h"
+
+
+/**
+* Fixed-capacity ring buffer used for storing server side rewind history.
+* Storage is allocated once in Init, after that pushing never allocates and simply
+* overwrites the oldest element in place once the buffer is full.
+* Elements are indexed from oldest (0) to newest (Num() - 1).
+* The engine-independent ServerSideRewindCore::TRingBuffer with its elements stored in a TArray.
+*/
+template<typename ElementType>
+using TServerSideRewindRingBuffer = ServerSideRewindCore::TRingBuffer<ElementType, TArray<ElementType>>;
@@ -0,0 +1,145 @@
+#include "ServerSideRewindShotReport.h"
+#include "ServerSideRewind/ServerSideRewind.h"
+
+
+bool FServerSideRewindShotReport::Pack(int32 BatchFrame, const FServerSideRewindFrameTime& Time, const FVector& InStart,
+	const FVector& Direction)
+{
+	const int32 Delta = BatchFrame - Time.Frame;
+	if (Delta < 0 || Delta > MAX_uint8) { return false; }
+
+	Start = InStart;
+
+	const FRotator Rotation = Direction.Rotation();
+	Yaw = FRotator::CompressAxisToShort(Rotation.Yaw);
+	Pitch = FRotator::CompressAxisToShort(Rotation.Pitch);
+
+	FrameDelta = static_cast<uint8>(Delta);
+	Alpha = static_cast<uint8>(FMath::Clamp(FMath::FloorToInt(Time.Alpha * 256.0f), 0, MAX_uint8));
+	return true;
+}
+
+FServerSideRewindFrameTime FServerSideRewindShotReport::GetTime(int32 BatchFrame) const
+{
+	/** Middle of the quantization step, off by at most 1/512 of a frame */
+	return FServerSideRewindFrameTime(BatchFrame - FrameDelta, (Alpha + 0.5f) / 256.0f);
+}
+
+FVector FServerSideRewindShotReport::GetDirection() const
+{
+	return FRotator(FRotator::DecompressAxisFromShort(Pitch), FRotator::DecompressAxisFromShort(Yaw), 0.0f).Vector();
+}
+
+bool FServerSideRewindShotReport::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	Start.NetSerialize(Ar, Map, bOutSuccess);
+	Ar << Yaw;
+	Ar << Pitch;
+	Ar << FrameDelta;
+	Ar << Alpha;
+	return bOutSuccess;
+}
+
+void FServerSideRewindShotSender::AddShot(const FServerSideRewindFrameTime& Time, const FVector& Start,
+	const FVector& Direction)
+{
+	FPendingShot& PendingShot = PendingShots.AddDefaulted_GetRef();
+	PendingShot.Time = Time;
+	PendingShot.Start = Start;
+	PendingShot.Direction = Direction;
+}
+
+void FServerSideRewindShotSender::Flush(float CurrentTime, TFunctionRef<void(const FServerSideRewindShotBatch&)> Send)
+{
+	/** Resend batches whose ack is overdue, give up on ones sent too often (the server might be gone) */
+	for (int32 Index = 0; Index < UnackedBatches.Num();)
+	{
+		FUnackedBatch& UnackedBatch = UnackedBatches[Index];
+		if (CurrentTime - UnackedBatch.LastSendTime < ResendInterval) { Index++; continue; }
+
+		if (UnackedBatch.NumSends >= MaxSends)
+		{
+			UnackedBatches.RemoveAt(Index, 1, false);
+			continue;
+		}
+
+		Send(UnackedBatch.Batch);
+		UnackedBatch.LastSendTime = CurrentTime;
+		UnackedBatch.NumSends++;
+		Index++;
+	}
+
+	/** Send every shot of the frame in one batch (more only if there are too many), timed relative to the newest one */
+	for (int32 FirstShot = 0; FirstShot < PendingShots.Num(); FirstShot += ServerSideRewind::MaxShotsPerBatch)
+	{
+		/** Acks can't reach batches more than 32 sequences behind the latest one */
+		if (UnackedBatches.Num() >= ServerSideRewind::MaxUnackedShotBatches) { UnackedBatches.RemoveAt(0, 1, false); }
+
+		const int32 NumShots = FMath::Min(PendingShots.Num() - FirstShot, ServerSideRewind::MaxShotsPerBatch);
+
+		FUnackedBatch& UnackedBatch = UnackedBatches.AddDefaulted_GetRef();
+		FServerSideRewindShotBatch& Batch = UnackedBatch.Batch;
+		Batch.Sequence = NextSequence++;
+		Batch.Frame = PendingShots[FirstShot + NumShots - 1].Time.Frame;
+		Batch.Shots.Reset(NumShots);
+		for (int32 Index = 0; Index < NumShots; Index++)
+		{
+			/** Shots older than the frame delta can hold couldn't be rewound to anyway, the newest one always fits */
+			const FPendingShot& PendingShot = PendingShots[FirstShot + Index];
+			FServerSideRewindShotReport& Shot = Batch.Shots.AddDefaulted_GetRef();
+			if (!Shot.Pack(Batch.Frame, PendingShot.Time, PendingShot.Start, PendingShot.Direction))
+			{
+				UE_LOG(LogServerSideRewind, Warning, TEXT("Dropped shot at frame %d, too old for batch at frame %d"),
+					PendingShot.Time.Frame, Batch.Frame);
+				Batch.Shots.Pop(false);
+			}
+		}
+
+		Send(Batch);
+		UnackedBatch.LastSendTime = CurrentTime;
+		UnackedBatch.NumSends = 1;
+	}
+	PendingShots.Reset();
+}
+
+void FServerSideRewindShotSender::Acknowledge(uint16 LatestSequence, uint32 AckBits)
+{
+	UnackedBatches.RemoveAll([LatestSequence, AckBits](const FUnackedBatch& UnackedBatch)
+	{
+		const uint16 Sequence = UnackedBatch.Batch.Sequence;
+		if (Sequence == LatestSequence) { return true; }
+		if (!ServerSideRewind::IsSequenceNewer(LatestSequence, Sequence)) { return false; }
+
+		const uint16 Distance = static_cast<uint16>(LatestSequence - 1 - Sequence);
+		return Distance < 32 && (AckBits & (1u << Distance)) != 0;
+	});
+}
+
+bool FServerSideRewindShotReceiver::Receive(uint16 Sequence)
+{
+	if (!bReceivedAny)
+	{
+		bReceivedAny = true;
+		LatestSequence = Sequence;
+		AckBits = 0;
+		return true;
+	}
+
+	/** Newer batch, shift the bits of the previous ones along */
+	if (ServerSideRewind::IsSequenceNewer(Sequence, LatestSequence))
+	{
+		const uint16 Shift = static_cast<uint16>(Sequence - LatestSequence);
+		AckBits = Shift > 32 ? 0 : ((AckBits << 1) | 1u) << (Shift - 1);
+		LatestSequence = Sequence;
+		return true;
+	}
+
+	/** Older batch, only new if it's still covered by the bits and wasn't received yet */
+	if (Sequence == LatestSequence) { return false; }
+
+	const uint16 Distance = static_cast<uint16>(LatestSequence - 1 - Sequence);
+	if (Distance >= 32 || (AckBits & (1u << Distance)) != 0) { return false; }
+
+	AckBits |= 1u << Distance;
+	return true;
+}
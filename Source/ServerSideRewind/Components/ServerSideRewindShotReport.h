@@ -0,0 +1,154 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "ServerSideRewindFrameTime.h"
+#include "ServerSideRewindShotReport.generated.h"
+
+
+namespace ServerSideRewind
+{
+	/** Max amount of shots in one batch, the server drops larger batches */
+	constexpr int32 MaxShotsPerBatch = 32;
+
+	/** Max amount of batches waiting for an ack, the ack bits only cover the 32 batches before the latest one */
+	constexpr int32 MaxUnackedShotBatches = 32;
+
+	/** Returns true if sequence A is newer than B, taking wrap around into account */
+	FORCEINLINE bool IsSequenceNewer(uint16 A, uint16 B)
+	{
+		return static_cast<int16>(A - B) > 0;
+	}
+}
+
+
+/**
+* Shot sent from the client to the server in a batch, direction and hit time quantized to 6 bytes plus the start.
+* The end of the shot isn't sent, the server traces along the direction up to the shot range.
+*/
+USTRUCT()
+struct FServerSideRewindShotReport
+{
+	GENERATED_BODY()
+
+	/** Start of the shot rounded to whole centimeters */
+	UPROPERTY()
+	FVector_NetQuantize Start = FVector::ZeroVector;
+
+	/** Direction of the shot as yaw and pitch compressed to 16 bits each */
+	UPROPERTY()
+	uint16 Yaw = 0;
+
+	UPROPERTY()
+	uint16 Pitch = 0;
+
+	/** Frames the shot was fired before the frame of its batch */
+	UPROPERTY()
+	uint8 FrameDelta = 0;
+
+	/** Fraction of the frame the shot was fired at, in 1/256 */
+	UPROPERTY()
+	uint8 Alpha = 0;
+
+	/**
+	* Quantizes shot fired at Time, which must not be after the frame of the batch.
+	* Returns false if the shot was fired too long before the frame of the batch for the frame delta to hold it.
+	*/
+	bool Pack(int32 BatchFrame, const FServerSideRewindFrameTime& Time, const FVector& InStart, const FVector& Direction);
+
+	FServerSideRewindFrameTime GetTime(int32 BatchFrame) const;
+	FVector GetDirection() const;
+
+	bool NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess);
+};
+
+template<>
+struct TStructOpsTypeTraits<FServerSideRewindShotReport> : public TStructOpsTypeTraitsBase2<FServerSideRewindShotReport>
+{
+	enum { WithNetSerializer = true };
+};
+
+/**
+* Shots fired by a client during one frame, sent in a single unreliable RPC and resent until acked.
+*/
+USTRUCT()
+struct FServerSideRewindShotBatch
+{
+	GENERATED_BODY()
+
+	/** Sequence number used for acking and dropping batches received twice */
+	UPROPERTY()
+	uint16 Sequence = 0;
+
+	/** Server frame of the newest shot, the others are sent as frame deltas to it */
+	UPROPERTY()
+	int32 Frame = 0;
+
+	UPROPERTY()
+	TArray<FServerSideRewindShotReport> Shots;
+};
+
+
+/**
+* Client side of the shot batches.
+* Collects the shots of a frame into one batch and resends batches the server hasn't acked in time.
+*/
+struct FServerSideRewindShotSender
+{
+	/** Seconds to wait for an ack before resending a batch */
+	float ResendInterval = 0.1f;
+
+	/** Amount of times a batch is sent before it's given up on */
+	int32 MaxSends = 5;
+
+	/** Adds shot to the batch sent with the next flush */
+	void AddShot(const FServerSideRewindFrameTime& Time, const FVector& Start, const FVector& Direction);
+
+	/** Sends the shots added since the last flush as a new batch and resends unacked batches that are due */
+	void Flush(float CurrentTime, TFunctionRef<void(const FServerSideRewindShotBatch&)> Send);
+
+	/** Removes the acked batches, AckBits marks which of the 32 sequences before the latest one were received */
+	void Acknowledge(uint16 LatestSequence, uint32 AckBits);
+
+private:
+	struct FPendingShot
+	{
+		FServerSideRewindFrameTime Time;
+		FVector Start = FVector::ZeroVector;
+		FVector Direction = FVector::ForwardVector;
+	};
+
+	struct FUnackedBatch
+	{
+		FServerSideRewindShotBatch Batch;
+		float LastSendTime = 0.0f;
+		int32 NumSends = 0;
+	};
+
+	/** Shots added since the last flush */
+	TArray<FPendingShot> PendingShots;
+
+	/** Batches sent but not acked yet, oldest first */
+	TArray<FUnackedBatch> UnackedBatches;
+
+	uint16 NextSequence = 0;
+};
+
+/**
+* Server side of the shot batches, tracks which sequences were received for acking and dropping duplicates.
+*/
+struct FServerSideRewindShotReceiver
+{
+	/** Returns false if the batch was received before or is too old to tell */
+	bool Receive(uint16 Sequence);
+
+	FORCEINLINE uint16 GetLatestSequence() const { return LatestSequence; }
+	FORCEINLINE uint32 GetAckBits() const { return AckBits; }
+
+private:
+	bool bReceivedAny = false;
+	uint16 LatestSequence = 0;
+
+	/** Bit n is set if sequence LatestSequence - 1 - n was received */
+	uint32 AckBits = 0;
+};
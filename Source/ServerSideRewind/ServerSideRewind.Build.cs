@@ -1,5 +1,6 @@
 // Copyright Epic Games, Inc. All Rights Reserved.
 
+using System.IO;
 using UnrealBuildTool;
 
 public class ServerSideRewind : ModuleRules
@@ -12,6 +13,9 @@ public class ServerSideRewind : ModuleRules
 
 		PrivateDependencyModuleNames.AddRange(new string[] {  });
 
+		// Engine-independent rewind core (header only, also builds standalone with CMake)
+		PublicIncludePaths.Add(Path.Combine(ModuleDirectory, "..", "ServerSideRewindCore", "Public"));
+
 		// Uncomment if you are using Slate UI
 		// PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });
 		
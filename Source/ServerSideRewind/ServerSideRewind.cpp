@@ -4,3 +4,34 @@
 #include "Modules/ModuleManager.h"
 
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, ServerSideRewind, "ServerSideRewind" );
+
+DEFINE_LOG_CATEGORY(LogServerSideRewind);
+UE_TRACE_CHANNEL_DEFINE(ServerSideRewindChannel);
+CSV_DEFINE_CATEGORY_MODULE(SERVERSIDEREWIND_API, ServerSideRewind, true);
+
+DEFINE_STAT(STAT_ServerSideRewindCapture);
+DEFINE_STAT(STAT_ServerSideRewindUpdateLODs);
+DEFINE_STAT(STAT_ServerSideRewindEviction);
+DEFINE_STAT(STAT_ServerSideRewindLookup);
+DEFINE_STAT(STAT_ServerSideRewindBroadphase);
+DEFINE_STAT(STAT_ServerSideRewindDispatch);
+DEFINE_STAT(STAT_ServerSideRewindComplete);
+DEFINE_STAT(STAT_ServerSideRewindMoveHitBoxes);
+DEFINE_STAT(STAT_ServerSideRewindTrace);
+DEFINE_STAT(STAT_ServerSideRewindSweep);
+
+DEFINE_STAT(STAT_ServerSideRewindShotsValidated);
+DEFINE_STAT(STAT_ServerSideRewindShotsRejected);
+DEFINE_STAT(STAT_ServerSideRewindShotsTooOld);
+DEFINE_STAT(STAT_ServerSideRewindShotsFallback);
+DEFINE_STAT(STAT_ServerSideRewindShotsClamped);
+DEFINE_STAT(STAT_ServerSideRewindShotsImplausible);
+DEFINE_STAT(STAT_ServerSideRewindShotDeferral);
+DEFINE_STAT(STAT_ServerSideRewindShotBudgetSpent);
+
+DEFINE_STAT(STAT_ServerSideRewindShotQueueDepth);
+DEFINE_STAT(STAT_ServerSideRewindFrames);
+DEFINE_STAT(STAT_ServerSideRewindFullLOD);
+DEFINE_STAT(STAT_ServerSideRewindReducedLOD);
+DEFINE_STAT(STAT_ServerSideRewindProxyLOD);
+DEFINE_STAT(STAT_ServerSideRewindHistoryMemory);
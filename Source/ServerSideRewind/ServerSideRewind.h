@@ -3,4 +3,49 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
 
+
+/** Server side rewind logging, per shot messages are Verbose (Log LogServerSideRewind Verbose to see them) */
+SERVERSIDEREWIND_API DECLARE_LOG_CATEGORY_EXTERN(LogServerSideRewind, Log, All);
+
+/** Per shot and per character Insights events, too noisy for the cpu channel (-trace=cpu,ServerSideRewind) */
+UE_TRACE_CHANNEL_EXTERN(ServerSideRewindChannel, SERVERSIDEREWIND_API);
+
+/** Shots validated, rejected, too old and deferred per frame (csv.Category ServerSideRewind) */
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(SERVERSIDEREWIND_API, ServerSideRewind);
+
+
+/**
+* Server side rewind stats (stat ServerSideRewind).
+*/
+DECLARE_STATS_GROUP(TEXT("ServerSideRewind"), STATGROUP_ServerSideRewind, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Capture"), STAT_ServerSideRewindCapture, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update LODs"), STAT_ServerSideRewindUpdateLODs, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Eviction"), STAT_ServerSideRewindEviction, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Lookup"), STAT_ServerSideRewindLookup, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Broadphase"), STAT_ServerSideRewindBroadphase, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Dispatch Shots"), STAT_ServerSideRewindDispatch, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Complete Shots"), STAT_ServerSideRewindComplete, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Move HitBoxes"), STAT_ServerSideRewindMoveHitBoxes, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Trace"), STAT_ServerSideRewindTrace, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Sweep"), STAT_ServerSideRewindSweep, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shots Validated"), STAT_ServerSideRewindShotsValidated, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shots Rejected"), STAT_ServerSideRewindShotsRejected, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shots Too Old"), STAT_ServerSideRewindShotsTooOld, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shots Without Rewind"), STAT_ServerSideRewindShotsFallback, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shots Clamped To Latency"), STAT_ServerSideRewindShotsClamped, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Shots Implausible"), STAT_ServerSideRewindShotsImplausible, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Max Shot Deferral (ms)"), STAT_ServerSideRewindShotDeferral, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Shot Budget Spent (us)"), STAT_ServerSideRewindShotBudgetSpent, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Shot Queue Depth"), STAT_ServerSideRewindShotQueueDepth, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Frames"), STAT_ServerSideRewindFrames, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Characters Full LOD"), STAT_ServerSideRewindFullLOD, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Characters Reduced LOD"), STAT_ServerSideRewindReducedLOD, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Characters Proxy LOD"), STAT_ServerSideRewindProxyLOD, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
+DECLARE_MEMORY_STAT_EXTERN(TEXT("History Memory"), STAT_ServerSideRewindHistoryMemory, STATGROUP_ServerSideRewind, SERVERSIDEREWIND_API);
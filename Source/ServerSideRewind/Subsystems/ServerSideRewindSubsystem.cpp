@@ -0,0 +1,1340 @@
+#include "ServerSideRewindSubsystem.h"
+#include "ServerSideRewind/ServerSideRewind.h"
+#include "ServerSideRewind/Character/FirstPersonCharacter.h"
+#include "Kismet/GameplayStatics.h"
+#include "GameFramework/GameStateBase.h"
+#include "Engine/NetDriver.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Async/ParallelFor.h"
+#include "Misc/ScopeExit.h"
+#include "Tasks/Task.h"
+#include "ServerSideRewindCore/TimeLookup.h"
+
+
+static TAutoConsoleVariable<bool> CVarServerSideRewindParallelCapture(
+	TEXT("ServerSideRewind.ParallelCapture"), true,
+	TEXT("Capture the snapshots of a frame on worker threads (false captures them serially on the game thread)."));
+
+static TAutoConsoleVariable<bool> CVarServerSideRewindAsyncShotValidation(
+	TEXT("ServerSideRewind.AsyncShotValidation"), true,
+	TEXT("Validate shots as tasks running in parallel with the rest of the frame (analytic hit test only)."));
+
+static TAutoConsoleVariable<float> CVarServerSideRewindShotBudget(
+	TEXT("ServerSideRewind.ShotBudget"), 2000.0f,
+	TEXT("Microseconds per frame spent validating shots (summed over all threads, 0 for no limit). ")
+	TEXT("Shots over budget are validated in the next frames against the frames at their original hit time."));
+
+static TAutoConsoleVariable<bool> CVarServerSideRewindOverloadFallback(
+	TEXT("ServerSideRewind.OverloadFallback"), false,
+	TEXT("Check shots deferred for longer than ServerSideRewind.MaxShotDeferral against the current hitboxes ")
+	TEXT("without rewinding them."));
+
+static TAutoConsoleVariable<float> CVarServerSideRewindMaxShotDeferral(
+	TEXT("ServerSideRewind.MaxShotDeferral"), 0.25f,
+	TEXT("Seconds a shot may be deferred by the shot budget before ServerSideRewind.OverloadFallback applies."));
+
+static TAutoConsoleVariable<int32> CVarServerSideRewindParallelCaptureMinCharacters(
+	TEXT("ServerSideRewind.ParallelCaptureMinCharacters"), 8,
+	TEXT("Min amount of character slots needed for capturing snapshots in parallel."));
+
+static TAutoConsoleVariable<float> CVarServerSideRewindRecordRate(
+	TEXT("ServerSideRewind.RecordRate"), 0.0f,
+	TEXT("Frames per second saved while no shots were fired recently, interpolation covers the gaps ")
+	TEXT("(0 saves a frame every tick)."));
+
+static TAutoConsoleVariable<float> CVarServerSideRewindCombatRecordTime(
+	TEXT("ServerSideRewind.CombatRecordTime"), 5.0f,
+	TEXT("Seconds after a shot during which a frame is saved every tick regardless of ServerSideRewind.RecordRate."));
+
+static TAutoConsoleVariable<float> CVarServerSideRewindUnchangedThreshold(
+	TEXT("ServerSideRewind.UnchangedThreshold"), 0.5f,
+	TEXT("Max distance in cm a hitbox may move relative to the actor root while still reusing the last stored pose ")
+	TEXT("(negative always stores the pose)."));
+
+static TAutoConsoleVariable<float> CVarServerSideRewindUnchangedAngleThreshold(
+	TEXT("ServerSideRewind.UnchangedAngleThreshold"), 0.5f,
+	TEXT("Max angle in degrees a hitbox may rotate while still reusing the last stored pose (negative always stores the pose)."));
+
+static TAutoConsoleVariable<bool> CVarServerSideRewindLOD(
+	TEXT("ServerSideRewind.LOD"), true,
+	TEXT("Record characters far away from and out of view of every other character with lower fidelity."));
+
+static TAutoConsoleVariable<float> CVarServerSideRewindLODFullDistance(
+	TEXT("ServerSideRewind.LOD.FullDistance"), 3000.0f,
+	TEXT("Characters closer than this to any other character are recorded at full fidelity."));
+
+static TAutoConsoleVariable<float> CVarServerSideRewindLODViewDistance(
+	TEXT("ServerSideRewind.LOD.ViewDistance"), 15000.0f,
+	TEXT("Characters within the view of any other character and closer than this are recorded at full fidelity."));
+
+static TAutoConsoleVariable<float> CVarServerSideRewindLODReducedDistance(
+	TEXT("ServerSideRewind.LOD.ReducedDistance"), 10000.0f,
+	TEXT("Characters closer than this to or in view of any other character are at least recorded at reduced fidelity, ")
+	TEXT("all others only as capsule proxy."));
+
+static TAutoConsoleVariable<float> CVarServerSideRewindLODViewAngle(
+	TEXT("ServerSideRewind.LOD.ViewAngle"), 60.0f,
+	TEXT("Half angle in degrees of the view cone of a character (wider than the actual view to cover aim latency)."));
+
+static TAutoConsoleVariable<int32> CVarServerSideRewindLODUpdateFrames(
+	TEXT("ServerSideRewind.LOD.UpdateFrames"), 4,
+	TEXT("Frames the demotion of all characters is spread over, ")
+	TEXT("characters are still promoted in the same frame they get close to or into the view of another character."));
+
+static TAutoConsoleVariable<int32> CVarServerSideRewindLODReducedRecordInterval(
+	TEXT("ServerSideRewind.LOD.ReducedRecordInterval"), 4,
+	TEXT("Characters at reduced fidelity store their pose every n-th frame and reuse it in between."));
+
+static TAutoConsoleVariable<bool> CVarServerSideRewindRecordBoneTransforms(
+	TEXT("ServerSideRewind.RecordBoneTransforms"), true,
+	TEXT("Record the bone transforms the hitboxes are attached to and reconstruct the hitboxes only for frames ")
+	TEXT("checked against (false records the hitbox transforms). Applies to characters registered afterwards."));
+
+static FAutoConsoleCommandWithWorld CmdServerSideRewindMemoryReport(
+	TEXT("ServerSideRewind.MemoryReport"),
+	TEXT("Logs the memory used by the frame history per player and second of history, ")
+	TEXT("compared to storing one full snapshot per player and frame."),
+	FConsoleCommandWithWorldDelegate::CreateLambda([](UWorld* World)
+	{
+		const UServerSideRewindSubsystem* Subsystem = World != nullptr ?
+			World->GetSubsystem<UServerSideRewindSubsystem>() : nullptr;
+		if (Subsystem == nullptr || Subsystem->GetFrameHistory().Num() < 2) { return; }
+
+		int32 NumPlayers = 0;
+		for (int32 Slot = 0; Slot < Subsystem->GetNumSlots(); Slot++)
+		{
+			if (Subsystem->GetCharacter(Slot) != nullptr) { NumPlayers++; }
+		}
+		if (NumPlayers == 0) { return; }
+
+		SIZE_T PackedBytes;
+		SIZE_T UnpackedBytes;
+		Subsystem->GetHistoryMemoryUsage(PackedBytes, UnpackedBytes);
+
+		const TServerSideRewindRingBuffer<FServerSideRewindFrame>& FrameHistory = Subsystem->GetFrameHistory();
+		const double Seconds = FrameHistory.GetNewest().Time.FramesSince(FrameHistory.GetOldest().Time) /
+			Subsystem->GetFrameRate();
+		if (Seconds <= 0.0) { return; }
+
+		UE_LOG(LogServerSideRewind, Display, TEXT("Server side rewind history: %d frames, %.2f s, %d players"),
+			FrameHistory.Num(), Seconds, NumPlayers);
+		UE_LOG(LogServerSideRewind, Display, TEXT("Full snapshots: %.0f bytes per player per second"),
+			UnpackedBytes / Seconds / NumPlayers);
+		UE_LOG(LogServerSideRewind, Display, TEXT("Packed records: %.0f bytes per player per second (%.1fx smaller)"),
+			PackedBytes / Seconds / NumPlayers, PackedBytes > 0 ? static_cast<double>(UnpackedBytes) / PackedBytes : 0.0);
+
+		const FServerSideRewindLODStats& LODStats = Subsystem->GetLODStats();
+		const TCHAR* LODNames[] = { TEXT("Full"), TEXT("Reduced"), TEXT("Proxy") };
+		for (int32 LOD = 0; LOD < static_cast<int32>(EServerSideRewindLOD::Num); LOD++)
+		{
+			UE_LOG(LogServerSideRewind, Display, TEXT("%s LOD: %d players, %.0f bytes per record"), LODNames[LOD],
+				LODStats.NumCharacters[LOD], LODStats.NumRecords[LOD] > 0 ?
+				static_cast<double>(LODStats.NumBytes[LOD]) / LODStats.NumRecords[LOD] : 0.0);
+		}
+	}));
+
+bool UServerSideRewindSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UServerSideRewindSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	PreActorTickHandle = FWorldDelegates::OnWorldPreActorTick.AddUObject(this,
+		&UServerSideRewindSubsystem::OnWorldPreActorTick);
+}
+
+void UServerSideRewindSubsystem::Deinitialize()
+{
+	FWorldDelegates::OnWorldPreActorTick.Remove(PreActorTickHandle);
+	WaitForValidationTasks();
+	HitBoxPool.Release();
+
+	Super::Deinitialize();
+}
+
+void UServerSideRewindSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	/** Frame history is only needed on the server */
+	if (InWorld.GetNetMode() != NM_Client) { InitFrameHistory(); }
+}
+
+TStatId UServerSideRewindSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UServerSideRewindSubsystem, STATGROUP_Tickables);
+}
+
+void UServerSideRewindSubsystem::InitFrameHistory()
+{
+	FrameRate = ServerSideRewind::GetFrameRate();
+
+	/** Ticking slower leaves frame numbers out (found by a binary search instead), faster ticks aren't recorded */
+	const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	const int32 ServerTickRate = NetDriver != nullptr ? NetDriver->GetNetServerMaxTickRate() : 0;
+	if (ServerTickRate > 0 && ServerTickRate != FrameRate)
+	{
+		UE_LOG(LogServerSideRewind, Log, TEXT("Server tick rate %d differs from ServerSideRewind.FrameRate %.0f"),
+			ServerTickRate, FrameRate);
+	}
+
+	/**
+	* One frame per frame number for MaxRewindTime seconds plus one to cover the full time span,
+	* plus one key frame interval since old frames can only be evicted together with their key frame
+	*/
+	const int32 Capacity = FMath::CeilToInt(MaxRewindTime * FrameRate) + 1 + ServerSideRewind::KeyFrameInterval;
+	FrameHistory.Init(Capacity);
+	HistoryPackedBytes = 0;
+	HistoryUnpackedBytes = 0;
+	NumSavedFrames = 0;
+}
+
+void UServerSideRewindSubsystem::SetMaxRewindTime(float InMaxRewindTime)
+{
+	MaxRewindTime = FMath::Max(InMaxRewindTime, 0.0f);
+
+	/** History is only allocated once play began on the server, otherwise OnWorldBeginPlay sizes it */
+	if (FrameHistory.Capacity() == 0) { return; }
+
+	/** Validation tasks might be decoding the frames about to be dropped */
+	WaitForValidationTasks();
+	InitFrameHistory();
+}
+
+void UServerSideRewindSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	/** Join shots dispatched this frame and validate shots queued since, before recording modifies the history */
+	CompleteQueuedShots();
+	if (!QueuedShots.IsEmpty())
+	{
+		DispatchQueuedShots();
+		CompleteQueuedShots();
+	}
+	FallBackOverdueShots();
+
+	/** Shots left in the queue are deferred to the next frames */
+	SET_DWORD_STAT(STAT_ServerSideRewindShotQueueDepth, QueuedShots.Num());
+	SET_FLOAT_STAT(STAT_ServerSideRewindShotDeferral, MaxShotDeferral * 1000.0f);
+	SET_FLOAT_STAT(STAT_ServerSideRewindShotBudgetSpent, ShotBudgetSpent * 1.0e6);
+	CSV_CUSTOM_STAT(ServerSideRewind, ShotQueueDepth, QueuedShots.Num(), ECsvCustomStatOp::Set);
+	CSV_CUSTOM_STAT(ServerSideRewind, MaxShotDeferralMs, MaxShotDeferral * 1000.0f, ECsvCustomStatOp::Max);
+
+	SaveServerSideRewindFrame();
+}
+
+int32 UServerSideRewindSubsystem::RegisterCharacter(AFirstPersonCharacter* Character)
+{
+	if (Character == nullptr) { return INDEX_NONE; }
+
+	/** Validation tasks might be decoding snapshots, which reads the slot arrays */
+	WaitForValidationTasks();
+
+	/** Reuse a free slot if possible, frames only grow when all slots are taken */
+	int32 Slot;
+	if (FreeSlots.Num() > 0)
+	{
+		Slot = FreeSlots.Pop(false);
+		Characters[Slot] = Character;
+	}
+	else
+	{
+		Slot = Characters.Add(Character);
+		SlotStates.AddDefaulted();
+	}
+
+	/** Record bone transforms if the hitboxes of the character's class can be reconstructed from them */
+	FServerSideRewindSlotState& SlotState = SlotStates[Slot];
+	SlotState.LastNumHitBoxes = 0;
+	SlotState.NumReusedFrames = 0;
+	SlotState.LOD = EServerSideRewindLOD::Full;
+	SlotState.HitBoxLayout = CVarServerSideRewindRecordBoneTransforms.GetValueOnGameThread() ?
+		FindHitBoxLayout(Character) : INDEX_NONE;
+	return Slot;
+}
+
+int32 UServerSideRewindSubsystem::FindHitBoxLayout(AFirstPersonCharacter* Character)
+{
+	if (const int32* LayoutIndex = HitBoxLayoutIndices.Find(Character->GetClass())) { return *LayoutIndex; }
+
+	FServerSideRewindHitBoxLayout Layout;
+	const int32 LayoutIndex = UServerSideRewindComponent::BuildHitBoxLayout(Character, Layout) ?
+		HitBoxLayouts.Add(Layout) : INDEX_NONE;
+	HitBoxLayoutIndices.Add(Character->GetClass(), LayoutIndex);
+	return LayoutIndex;
+}
+
+void UServerSideRewindSubsystem::UnregisterCharacter(int32 Slot)
+{
+	if (!Characters.IsValidIndex(Slot) || Characters[Slot] == nullptr) { return; }
+
+	/** Validation tasks might be reading the slot, results of its checks must not go to the next character */
+	WaitForValidationTasks();
+	for (FServerSideRewindShotCheck& ShotCheck : ShotChecks)
+	{
+		if (ShotCheck.Slot == Slot) { ShotCheck.HitResult = FServerSideRewindHitResult(); }
+	}
+
+	Characters[Slot] = nullptr;
+	FreeSlots.Add(Slot);
+
+	/** Next character using the slot starts with full positions */
+	SlotStates[Slot].LastNumHitBoxes = 0;
+
+	/** Clear slot in the history so the next character using it can't be rewound to this one */
+	for (int32 Index = 0; Index < FrameHistory.Num(); Index++)
+	{
+		FServerSideRewindFrame& Frame = FrameHistory[Index];
+		if (Frame.Records.IsValidIndex(Slot)) { Frame.Records[Slot].Encoding = EServerSideRewindRecordEncoding::Empty; }
+	}
+}
+
+void UServerSideRewindSubsystem::SaveServerSideRewindFrame()
+{
+	if (FrameHistory.Capacity() == 0) { return; }
+
+	SCOPE_CYCLE_COUNTER(STAT_ServerSideRewindCapture);
+
+	/** Get game state if nullptr, otherwise use the member variable */
+	GameState = GameState == nullptr ? UGameplayStatics::GetGameState(this) : GameState;
+	if (GameState == nullptr) { return; }
+
+	/** Frame numbers of the recorded frames are on the grid of the old frame rate */
+	if (ServerSideRewind::GetFrameRate() != FrameRate)
+	{
+		WaitForValidationTasks();
+		InitFrameHistory();
+	}
+
+	/**
+	* Fixed rate, the pose is recorded at most once per frame number.
+	* It keeps the time it was actually captured at, the lookup interpolates between the real capture times.
+	*/
+	const FServerSideRewindFrameTime FrameTime = FServerSideRewindFrameTime::FromSeconds(
+		GameState->GetServerWorldTimeSeconds(), FrameRate);
+	if (!FrameHistory.IsEmpty() && FrameTime.Frame <= FrameHistory.GetNewest().Time.Frame) { return; }
+	if (!ShouldSaveFrame(FrameTime.Frame)) { return; }
+
+	/** Convert the unchanged thresholds to quantized units (rotation components change by about half the angle) */
+	const float PositionThreshold = CVarServerSideRewindUnchangedThreshold.GetValueOnGameThread();
+	const float AngleThreshold = CVarServerSideRewindUnchangedAngleThreshold.GetValueOnGameThread();
+	UnchangedPositionThreshold = PositionThreshold < 0.0f ? -1 :
+		FMath::FloorToInt(PositionThreshold / ServerSideRewind::PositionQuantum);
+	UnchangedRotationThreshold = AngleThreshold < 0.0f ? -1 :
+		FMath::FloorToInt(FMath::Sin(FMath::DegreesToRadians(AngleThreshold) * 0.5f) / (UE_SQRT_2 / 32767.0f));
+	ReducedRecordInterval = FMath::Max(CVarServerSideRewindLODReducedRecordInterval.GetValueOnGameThread(), 1);
+
+	UpdateLODs();
+
+	/** Encode snapshots directly into the next frame (reuses the slot of the oldest one if full) */
+	if (FrameHistory.IsFull()) { PopOldestFrame(); }
+	FServerSideRewindFrame& Frame = FrameHistory.Push();
+	Frame.Time = FrameTime;
+	Frame.bKeyFrame = NumSavedFrames++ % ServerSideRewind::KeyFrameInterval == 0;
+
+	/** Reset keeps the allocations, so this only allocates when characters registered since this frame was last used */
+	Frame.Records.SetNum(Characters.Num(), false);
+	Frame.KeyPositions.Reset();
+	Frame.DeltaPositions.Reset();
+	Frame.Rotations.Reset();
+	Frame.Extents.Reset();
+
+	/** Every slot writes only into its own record and slot state, so no locking is needed */
+	const bool bParallelCapture = CVarServerSideRewindParallelCapture.GetValueOnGameThread() &&
+		Characters.Num() >= CVarServerSideRewindParallelCaptureMinCharacters.GetValueOnGameThread();
+
+	ParallelFor(Characters.Num(), [this, &Frame](int32 Slot)
+	{
+		CaptureSlot(Frame, Slot);
+	}, bParallelCapture ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+
+	/** Append the encoded poses of every slot to the frame */
+	for (int32 Slot = 0; Slot < Characters.Num(); Slot++)
+	{
+		FServerSideRewindPackedRecord& Record = Frame.Records[Slot];
+		FServerSideRewindSlotState& SlotState = SlotStates[Slot];
+
+		if (Record.IsEmpty())
+		{
+			SlotState.LastNumHitBoxes = 0;
+			continue;
+		}
+
+		const int32 LOD = static_cast<int32>(SlotState.LOD);
+		LODStats.NumRecords[LOD]++;
+		LODStats.NumBytes[LOD] += sizeof(FServerSideRewindPackedRecord);
+
+		if (Record.Encoding == EServerSideRewindRecordEncoding::Unchanged) { continue; }
+
+		/** Poses after a proxy have to start with full positions */
+		if (Record.Encoding == EServerSideRewindRecordEncoding::Proxy)
+		{
+			Record.ExtentsIndex = Frame.Extents.Add(SlotState.CapturedExtents[0]);
+			LODStats.NumBytes[LOD] += sizeof(FVector3f);
+			SlotState.LastNumHitBoxes = 0;
+			continue;
+		}
+
+		/** Key records carry the extents, so every frame decodes with the extents its pose was captured with */
+		if (Record.Encoding == EServerSideRewindRecordEncoding::Key)
+		{
+			Record.PositionIndex = Frame.KeyPositions.Add(SlotState.CapturedPositions);
+			Record.ExtentsIndex = Frame.Extents.Num();
+			Frame.Extents.Append(SlotState.CapturedExtents, Record.NumHitBoxes);
+			LODStats.NumBytes[LOD] += sizeof(FServerSideRewindKeyPositions) + Record.NumHitBoxes * sizeof(FVector3f);
+			FMemory::Memcpy(SlotState.LastExtents, SlotState.CapturedExtents, Record.NumHitBoxes * sizeof(FVector3f));
+		}
+		else
+		{
+			Record.PositionIndex = Frame.DeltaPositions.Add(SlotState.CapturedDelta);
+			LODStats.NumBytes[LOD] += sizeof(FServerSideRewindDeltaPositions);
+		}
+		Record.RotationIndex = Frame.Rotations.Add(SlotState.CapturedRotations);
+		LODStats.NumBytes[LOD] += sizeof(FServerSideRewindPackedRotations);
+
+		SlotState.LastPositions = SlotState.CapturedPositions;
+		SlotState.LastRotations = SlotState.CapturedRotations;
+		SlotState.LastNumHitBoxes = Record.NumHitBoxes;
+		SlotState.LastBoundsMin = Record.BoundsMin - FVector3f(Record.RootLocation);
+		SlotState.LastBoundsMax = Record.BoundsMax - FVector3f(Record.RootLocation);
+	}
+
+	SortFrameSlots(Frame);
+
+	/** The frame isn't changed anymore once saved, so its size can be counted once and subtracted when it's removed */
+	HistoryPackedBytes += sizeof(FServerSideRewindFrame) + Frame.GetAllocatedSize();
+	HistoryUnpackedBytes += Frame.GetUnpackedSize();
+
+	EvictOldFrames();
+
+#if STATS
+	SIZE_T PackedBytes;
+	SIZE_T UnpackedBytes;
+	GetHistoryMemoryUsage(PackedBytes, UnpackedBytes);
+	SET_MEMORY_STAT(STAT_ServerSideRewindHistoryMemory, PackedBytes);
+	SET_DWORD_STAT(STAT_ServerSideRewindFrames, FrameHistory.Num());
+	SET_DWORD_STAT(STAT_ServerSideRewindFullLOD, LODStats.NumCharacters[static_cast<int32>(EServerSideRewindLOD::Full)]);
+	SET_DWORD_STAT(STAT_ServerSideRewindReducedLOD, LODStats.NumCharacters[static_cast<int32>(EServerSideRewindLOD::Reduced)]);
+	SET_DWORD_STAT(STAT_ServerSideRewindProxyLOD, LODStats.NumCharacters[static_cast<int32>(EServerSideRewindLOD::Proxy)]);
+#endif
+}
+
+void UServerSideRewindSubsystem::CaptureSlot(FServerSideRewindFrame& Frame, int32 Slot)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(ServerSideRewind_CaptureSlot, ServerSideRewindChannel);
+
+	FServerSideRewindPackedRecord& Record = Frame.Records[Slot];
+	FServerSideRewindSlotState& SlotState = SlotStates[Slot];
+
+	Record.Encoding = EServerSideRewindRecordEncoding::Empty;
+	Record.NumHitBoxes = 0;
+	if (Characters[Slot] == nullptr) { return; }
+
+	if (SlotState.LOD == EServerSideRewindLOD::Proxy)
+	{
+		CaptureProxy(Frame, Slot);
+		return;
+	}
+
+	/** Reduced characters reuse their last pose for a few frames, only the root is read */
+	if (SlotState.LOD == EServerSideRewindLOD::Reduced && !Frame.bKeyFrame && SlotState.LastNumHitBoxes > 0 &&
+		++SlotState.NumReusedFrames < ReducedRecordInterval)
+	{
+		Record.RootLocation = Characters[Slot]->GetActorLocation();
+		ServerSideRewind::PackRotation(Characters[Slot]->GetActorQuat(), Record.RootRotation);
+		Record.BoundsMin = SlotState.LastBoundsMin + FVector3f(Record.RootLocation);
+		Record.BoundsMax = SlotState.LastBoundsMax + FVector3f(Record.RootLocation);
+		Record.NumHitBoxes = SlotState.LastNumHitBoxes;
+		Record.Encoding = EServerSideRewindRecordEncoding::Unchanged;
+		return;
+	}
+	SlotState.NumReusedFrames = 0;
+
+	const int32 NumHitBoxes = SlotState.HitBoxLayout != INDEX_NONE ?
+		CaptureBoneTransforms(Frame, Slot) : CaptureHitBoxTransforms(Frame, Slot);
+	Record.NumHitBoxes = NumHitBoxes;
+	if (NumHitBoxes == 0) { return; }
+
+	/** Deltas and unchanged markers are only possible if the character's last pose has the same hitboxes */
+	bool bDeltaFits = !Frame.bKeyFrame && SlotState.LastNumHitBoxes == NumHitBoxes &&
+		FMemory::Memcmp(SlotState.CapturedExtents, SlotState.LastExtents, NumHitBoxes * sizeof(FVector3f)) == 0;
+	bool bUnchanged = bDeltaFits;
+
+	for (int32 Index = 0; Index < NumHitBoxes; Index++)
+	{
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			const int32 Delta = SlotState.CapturedPositions.Positions[Index][Axis] -
+				SlotState.LastPositions.Positions[Index][Axis];
+			bDeltaFits &= Delta >= MIN_int8 && Delta <= MAX_int8;
+			bUnchanged &= FMath::Abs(Delta) <= UnchangedPositionThreshold;
+			SlotState.CapturedDelta.Positions[Index][Axis] = static_cast<int8>(Delta);
+
+			/** Top bits of words 0 and 1 hold the index of the dropped component, which has to match as well */
+			const int32 Rotation = SlotState.CapturedRotations.Rotations[Index][Axis];
+			const int32 LastRotation = SlotState.LastRotations.Rotations[Index][Axis];
+			bUnchanged &= (Rotation >> 15) == (LastRotation >> 15) &&
+				FMath::Abs((Rotation & 0x7FFF) - (LastRotation & 0x7FFF)) <= UnchangedRotationThreshold;
+		}
+	}
+
+	/**
+	* Idle characters only store a marker reusing their last pose (their root is still stored),
+	* others fall back to full positions if any hitbox moved too far relative to the root since the last pose
+	*/
+	if (bUnchanged) { Record.Encoding = EServerSideRewindRecordEncoding::Unchanged; }
+	else if (bDeltaFits) { Record.Encoding = EServerSideRewindRecordEncoding::Delta; }
+	else { Record.Encoding = EServerSideRewindRecordEncoding::Key; }
+}
+
+void UServerSideRewindSubsystem::CaptureProxy(FServerSideRewindFrame& Frame, int32 Slot)
+{
+	FServerSideRewindPackedRecord& Record = Frame.Records[Slot];
+	FServerSideRewindSlotState& SlotState = SlotStates[Slot];
+	const AFirstPersonCharacter* Character = Characters[Slot];
+	const UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+
+	Record.RootLocation = Character->GetActorLocation();
+	ServerSideRewind::PackRotation(Character->GetActorQuat(), Record.RootRotation);
+
+	const float Radius = Capsule->GetScaledCapsuleRadius();
+	const FVector ProxyExtent(Radius, Radius, Capsule->GetScaledCapsuleHalfHeight());
+	SlotState.CapturedExtents[0] = FVector3f(ProxyExtent);
+	Record.SetBounds(FBox(-ProxyExtent, ProxyExtent).TransformBy(Character->GetActorTransform()));
+
+	Record.NumHitBoxes = 1;
+	Record.Encoding = EServerSideRewindRecordEncoding::Proxy;
+}
+
+void UServerSideRewindSubsystem::UpdateLODs()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ServerSideRewindUpdateLODs);
+
+	FMemory::Memzero(LODStats.NumCharacters);
+
+	const bool bLOD = CVarServerSideRewindLOD.GetValueOnGameThread();
+	const double FullDistanceSquared = FMath::Square(CVarServerSideRewindLODFullDistance.GetValueOnGameThread());
+	const double ViewDistanceSquared = FMath::Square(CVarServerSideRewindLODViewDistance.GetValueOnGameThread());
+	const double ReducedDistanceSquared = FMath::Square(CVarServerSideRewindLODReducedDistance.GetValueOnGameThread());
+	const double CosViewAngle = FMath::Cos(FMath::DegreesToRadians(CVarServerSideRewindLODViewAngle.GetValueOnGameThread()));
+
+	/** Gather views once, every character is compared against all others */
+	ViewLocations.SetNum(Characters.Num(), false);
+	ViewDirections.SetNum(Characters.Num(), false);
+	for (int32 Slot = 0; bLOD && Slot < Characters.Num(); Slot++)
+	{
+		if (Characters[Slot] == nullptr) { continue; }
+
+		ViewLocations[Slot] = Characters[Slot]->GetPawnViewLocation();
+		ViewDirections[Slot] = Characters[Slot]->GetBaseAimRotation().Vector();
+	}
+
+	/** LOD the character in the slot needs right now, stops as soon as any other character needs it in full */
+	const auto FindLOD = [&](int32 Slot)
+	{
+		EServerSideRewindLOD LOD = EServerSideRewindLOD::Proxy;
+		const FVector Location = Characters[Slot]->GetActorLocation();
+
+		for (int32 OtherSlot = 0; LOD != EServerSideRewindLOD::Full && OtherSlot < Characters.Num(); OtherSlot++)
+		{
+			if (OtherSlot == Slot || Characters[OtherSlot] == nullptr) { continue; }
+
+			const FVector ToCharacter = Location - ViewLocations[OtherSlot];
+			const double DistanceSquared = ToCharacter.SizeSquared();
+			const double Dot = FVector::DotProduct(ViewDirections[OtherSlot], ToCharacter);
+			const bool bInView = Dot > 0.0 && Dot * Dot >= CosViewAngle * CosViewAngle * DistanceSquared;
+
+			if (DistanceSquared <= FullDistanceSquared || (bInView && DistanceSquared <= ViewDistanceSquared))
+			{
+				LOD = EServerSideRewindLOD::Full;
+			}
+			else if (bInView || DistanceSquared <= ReducedDistanceSquared)
+			{
+				LOD = EServerSideRewindLOD::Reduced;
+			}
+		}
+		return LOD;
+	};
+
+	/**
+	* Demotions are spread over a few frames, only a slice of the characters may lose fidelity every frame.
+	* Characters below full fidelity are checked every frame, so they are promoted before any shot could need them.
+	*/
+	const int32 UpdateFrames = bLOD ? FMath::Max(CVarServerSideRewindLODUpdateFrames.GetValueOnGameThread(), 1) : 1;
+	const int32 NumDemotable = FMath::DivideAndRoundUp(Characters.Num(), UpdateFrames);
+	for (int32 Slot = 0; Slot < Characters.Num(); Slot++)
+	{
+		if (Characters[Slot] == nullptr) { continue; }
+
+		EServerSideRewindLOD& LOD = SlotStates[Slot].LOD;
+		const int32 SliceIndex = (Slot - NextLODSlot + Characters.Num()) % Characters.Num();
+		if (!bLOD) { LOD = EServerSideRewindLOD::Full; }
+		else if (SliceIndex < NumDemotable) { LOD = FindLOD(Slot); }
+		else if (LOD != EServerSideRewindLOD::Full) { LOD = FMath::Min(LOD, FindLOD(Slot)); }
+
+		LODStats.NumCharacters[static_cast<int32>(LOD)]++;
+	}
+	NextLODSlot = Characters.Num() > 0 ? (NextLODSlot + NumDemotable) % Characters.Num() : 0;
+}
+
+int32 UServerSideRewindSubsystem::CaptureHitBoxTransforms(FServerSideRewindFrame& Frame, int32 Slot)
+{
+	FServerSideRewindPackedRecord& Record = Frame.Records[Slot];
+	FServerSideRewindSlotState& SlotState = SlotStates[Slot];
+	FServerSideRewindSnapshot& Snapshot = SlotState.CapturedSnapshot;
+
+	UServerSideRewindComponent::TakeServerSideRewindSnapshot(Characters[Slot], Frame.Time, Snapshot);
+	if (Snapshot.NumHitBoxes == 0) { return 0; }
+
+	Record.RootLocation = Characters[Slot]->GetActorLocation();
+	Record.SetBounds(Snapshot.Bounds);
+
+	for (int32 Index = 0; Index < Snapshot.NumHitBoxes; Index++)
+	{
+		ServerSideRewind::QuantizePosition(Snapshot.HitBoxLocations[Index], Record.RootLocation,
+			SlotState.CapturedPositions.Positions[Index]);
+		ServerSideRewind::PackRotation(Snapshot.HitBoxRotations[Index], SlotState.CapturedRotations.Rotations[Index]);
+		SlotState.CapturedExtents[Index] = FVector3f(Snapshot.HitBoxExtents[Index]);
+	}
+	return Snapshot.NumHitBoxes;
+}
+
+int32 UServerSideRewindSubsystem::CaptureBoneTransforms(FServerSideRewindFrame& Frame, int32 Slot)
+{
+	FServerSideRewindPackedRecord& Record = Frame.Records[Slot];
+	FServerSideRewindSlotState& SlotState = SlotStates[Slot];
+	const FServerSideRewindHitBoxLayout& Layout = HitBoxLayouts[SlotState.HitBoxLayout];
+	const USkeletalMeshComponent* Mesh = Characters[Slot]->GetMesh();
+	const TArray<FTransform>& BoneTransforms = Mesh->GetComponentSpaceTransforms();
+
+	/** Component space positions are already relative to the mesh, so they are quantized as they are */
+	Record.RootLocation = Characters[Slot]->GetActorLocation();
+	ServerSideRewind::PackRotation(Characters[Slot]->GetActorQuat(), Record.RootRotation);
+
+	/** Mesh bounds contain the bones, grow them so they contain the hitboxes attached to them too */
+	Record.SetBounds(Mesh->Bounds.GetBox().ExpandBy(Layout.BoundsMargin));
+
+	for (int32 Index = 0; Index < Layout.NumHitBoxes; Index++)
+	{
+		/** Bone transforms aren't there before the mesh has been posed for the first time */
+		if (!BoneTransforms.IsValidIndex(Layout.BoneIndices[Index])) { return 0; }
+
+		const FTransform& BoneTransform = BoneTransforms[Layout.BoneIndices[Index]];
+		ServerSideRewind::QuantizePosition(BoneTransform.GetLocation(), FVector::ZeroVector,
+			SlotState.CapturedPositions.Positions[Index]);
+		ServerSideRewind::PackRotation(BoneTransform.GetRotation(), SlotState.CapturedRotations.Rotations[Index]);
+		SlotState.CapturedExtents[Index] = FVector3f(Layout.HitBoxExtents[Index]);
+	}
+	return Layout.NumHitBoxes;
+}
+
+void UServerSideRewindSubsystem::EvictOldFrames()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ServerSideRewindEviction);
+
+	/** Frames after an overwritten key frame can't be decoded anymore */
+	while (FrameHistory.Num() > 1 && !FrameHistory.GetOldest().bKeyFrame)
+	{
+		PopOldestFrame();
+	}
+
+	/**
+	* Remove frames older than MaxRewindTime a whole key frame interval at a time,
+	* once the next key frame alone is old enough to keep the full time span covered
+	*/
+	while (true)
+	{
+		int32 NextKeyFrame = 1;
+		while (NextKeyFrame < FrameHistory.Num() && !FrameHistory[NextKeyFrame].bKeyFrame) { NextKeyFrame++; }
+
+		if (NextKeyFrame >= FrameHistory.Num() - 1 ||
+			FrameHistory.GetNewest().Time.FramesSince(FrameHistory[NextKeyFrame].Time) <= MaxRewindTime * FrameRate)
+		{
+			break;
+		}
+
+		for (int32 Index = 0; Index < NextKeyFrame; Index++) { PopOldestFrame(); }
+	}
+}
+
+void UServerSideRewindSubsystem::PopOldestFrame()
+{
+	const FServerSideRewindFrame& Frame = FrameHistory.GetOldest();
+	HistoryPackedBytes -= sizeof(FServerSideRewindFrame) + Frame.GetAllocatedSize();
+	HistoryUnpackedBytes -= Frame.GetUnpackedSize();
+	FrameHistory.PopOldest();
+}
+
+bool UServerSideRewindSubsystem::ShouldSaveFrame(int32 FrameNumber) const
+{
+	const float RecordRate = CVarServerSideRewindRecordRate.GetValueOnGameThread();
+	if (RecordRate <= 0.0f || FrameHistory.IsEmpty()) { return true; }
+
+	/** Shots check the past, so fights are recorded every tick for a while once they started */
+	if (GetWorld()->GetTimeSeconds() - LastShotTime < CVarServerSideRewindCombatRecordTime.GetValueOnGameThread())
+	{
+		return true;
+	}
+	return FrameNumber - FrameHistory.GetNewest().Time.Frame >= FrameRate / RecordRate;
+}
+
+void UServerSideRewindSubsystem::QueueShot(int32 ShooterSlot, const FServerSideRewindFrameTime& Time,
+	const FVector& Start, const FVector& End, int32 MaxHits)
+{
+	LastShotTime = GetWorld()->GetTimeSeconds();
+
+	FServerSideRewindShot& Shot = QueuedShots.AddDefaulted_GetRef();
+	Shot.ShooterSlot = ShooterSlot;
+	Shot.Time = Time;
+	Shot.Start = Start;
+	Shot.End = End;
+	Shot.QueuedTime = LastShotTime;
+	Shot.MaxHits = FMath::Max(MaxHits, 1);
+}
+
+void UServerSideRewindSubsystem::OnWorldPreActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaTime)
+{
+	if (InWorld != GetWorld()) { return; }
+
+	/** New frame, new shot budget */
+	ShotBudgetSpent = 0.0;
+	MaxShotDeferral = 0.0f;
+
+	/** Shot RPCs have been received at this point of the frame */
+	DispatchQueuedShots();
+}
+
+void UServerSideRewindSubsystem::DispatchQueuedShots()
+{
+	if (QueuedShots.IsEmpty() || !InFlightShots.IsEmpty()) { return; }
+
+	/** Budget of this frame already used up, the queue waits for the next one */
+	const int32 NumShots = GetNumShotsWithinBudget();
+	if (NumShots == 0) { return; }
+
+	SCOPE_CYCLE_COUNTER(STAT_ServerSideRewindDispatch);
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	/**
+	* Swap buffers, shots queued from now on are validated in the next batch.
+	* Shots over budget stay queued with their original hit time, the oldest ones are validated first.
+	*/
+	if (NumShots == QueuedShots.Num()) { Swap(QueuedShots, InFlightShots); }
+	else
+	{
+		InFlightShots.Append(QueuedShots.GetData(), NumShots);
+		QueuedShots.RemoveAt(0, NumShots, false);
+	}
+
+	/** Broadphase, find all characters every shot could have touched */
+	for (int32 ShotIndex = 0; ShotIndex < InFlightShots.Num(); ShotIndex++)
+	{
+		const FServerSideRewindShot& Shot = InFlightShots[ShotIndex];
+		if (FrameHistory.IsEmpty() || Shot.Time < FrameHistory.GetOldest().Time)
+		{
+			UE_LOG(LogServerSideRewind, Verbose, TEXT("Shot at frame %d is older than the history"), Shot.Time.Frame);
+			NumShotsTooOld++;
+			continue;
+		}
+
+		FindCandidates(Shot.Time, Shot.Start, Shot.End, CandidateSlots);
+
+		for (const int32 Slot : CandidateSlots)
+		{
+			if (Slot == Shot.ShooterSlot) { continue; }
+
+			FServerSideRewindShotCheck& ShotCheck = ShotChecks.AddDefaulted_GetRef();
+			ShotCheck.ShotIndex = ShotIndex;
+			ShotCheck.Slot = Slot;
+			ShotCheck.Time = Shot.Time;
+		}
+	}
+
+	/** Group checks by character and hit time, so every rewound pose is only built once */
+	ShotChecks.Sort([](const FServerSideRewindShotCheck& A, const FServerSideRewindShotCheck& B)
+	{
+		return A.Slot != B.Slot ? A.Slot < B.Slot : A.Time < B.Time;
+	});
+
+	for (int32 FirstCheck = 0; FirstCheck < ShotChecks.Num();)
+	{
+		FServerSideRewindShotGroup& ShotGroup = ShotGroups.AddDefaulted_GetRef();
+		ShotGroup.Slot = ShotChecks[FirstCheck].Slot;
+		ShotGroup.Time = ShotChecks[FirstCheck].Time;
+		ShotGroup.FirstCheck = FirstCheck;
+		ShotGroup.NumChecks = 1;
+
+		while (FirstCheck + ShotGroup.NumChecks < ShotChecks.Num() &&
+			ShotChecks[FirstCheck + ShotGroup.NumChecks].Slot == ShotGroup.Slot &&
+			ShotChecks[FirstCheck + ShotGroup.NumChecks].Time == ShotGroup.Time)
+		{
+			ShotGroup.NumChecks++;
+		}
+		FirstCheck += ShotGroup.NumChecks;
+	}
+
+	ValidationCycles += FPlatformTime::Cycles64() - StartCycles;
+
+	/** Physics checks have to move components, so they can only run on the game thread in CompleteQueuedShots */
+	if (!UServerSideRewindComponent::UseAnalyticHitTest() ||
+		!CVarServerSideRewindAsyncShotValidation.GetValueOnGameThread())
+	{
+		return;
+	}
+
+	bValidatingWithTasks = true;
+	for (int32 GroupIndex = 0; GroupIndex < ShotGroups.Num(); GroupIndex++)
+	{
+		ValidationTasks.Add(UE::Tasks::Launch(UE_SOURCE_LOCATION, [this, GroupIndex]()
+		{
+			const uint64 GroupStartCycles = FPlatformTime::Cycles64();
+			CheckShotGroupAnalytic(ShotGroups[GroupIndex]);
+			ValidationCycles += FPlatformTime::Cycles64() - GroupStartCycles;
+		}));
+	}
+}
+
+void UServerSideRewindSubsystem::WaitForValidationTasks()
+{
+	if (ValidationTasks.IsEmpty()) { return; }
+
+	UE::Tasks::Wait(ValidationTasks);
+	ValidationTasks.Reset();
+}
+
+void UServerSideRewindSubsystem::CompleteQueuedShots()
+{
+	if (InFlightShots.IsEmpty()) { return; }
+
+	SCOPE_CYCLE_COUNTER(STAT_ServerSideRewindComplete);
+
+	/** Validate groups that weren't launched as tasks on the game thread */
+	if (!bValidatingWithTasks)
+	{
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		ON_SCOPE_EXIT { ValidationCycles += FPlatformTime::Cycles64() - StartCycles; };
+
+		const bool bAnalytic = UServerSideRewindComponent::UseAnalyticHitTest();
+		for (const FServerSideRewindShotGroup& ShotGroup : ShotGroups)
+		{
+			if (bAnalytic) { CheckShotGroupAnalytic(ShotGroup); }
+			else { CheckShotGroupPhysics(ShotGroup); }
+		}
+		if (!bAnalytic) { HitBoxPool.Disable(); }
+	}
+	WaitForValidationTasks();
+	bValidatingWithTasks = false;
+
+	/** Waiting for the tasks isn't counted, the time they ran for already is */
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	/** Every character hit by a shot, ordered along the line of the shot */
+	ShotHits.Reset();
+	for (const FServerSideRewindShotCheck& ShotCheck : ShotChecks)
+	{
+		AFirstPersonCharacter* HitCharacter = GetCharacter(ShotCheck.Slot);
+		if (!ShotCheck.HitResult.bHit || HitCharacter == nullptr) { continue; }
+
+		FServerSideRewindShotHit& ShotHit = ShotHits.AddDefaulted_GetRef();
+		ShotHit.ShotIndex = ShotCheck.ShotIndex;
+		ShotHit.HitCharacter = HitCharacter;
+		ShotHit.HitResult = ShotCheck.HitResult;
+		if (HitCharacter->HitBoxBoneNames.IsValidIndex(ShotHit.HitResult.HitBoxIndex))
+		{
+			ShotHit.HitResult.BoneName = HitCharacter->HitBoxBoneNames[ShotHit.HitResult.HitBoxIndex];
+		}
+	}
+	ShotHits.Sort([](const FServerSideRewindShotHit& A, const FServerSideRewindShotHit& B)
+	{
+		return A.ShotIndex != B.ShotIndex ? A.ShotIndex < B.ShotIndex : A.HitResult.Distance < B.HitResult.Distance;
+	});
+
+	/** Shots stop after as many characters as they can penetrate */
+	ShotResults.Reset();
+	ShotResults.SetNum(InFlightShots.Num());
+	for (int32 FirstHit = 0, NumShotHits = 0; FirstHit < ShotHits.Num(); FirstHit += NumShotHits)
+	{
+		const int32 ShotIndex = ShotHits[FirstHit].ShotIndex;
+		NumShotHits = 1;
+		while (FirstHit + NumShotHits < ShotHits.Num() && ShotHits[FirstHit + NumShotHits].ShotIndex == ShotIndex)
+		{
+			NumShotHits++;
+		}
+
+		FServerSideRewindShotResult& ShotResult = ShotResults[ShotIndex];
+		ShotResult.FirstHit = FirstHit;
+		ShotResult.NumHits = FMath::Min(NumShotHits, InFlightShots[ShotIndex].MaxHits);
+	}
+
+	/** Kill every character hit by at least one shot (once) */
+	KilledCharacters.Reset();
+	for (int32 ShotIndex = 0; ShotIndex < ShotResults.Num(); ShotIndex++)
+	{
+		const FServerSideRewindShotResult& ShotResult = ShotResults[ShotIndex];
+		if (ShotResult.NumHits == 0) { continue; }
+
+		const TArrayView<const FServerSideRewindShotHit> Hits(&ShotHits[ShotResult.FirstHit], ShotResult.NumHits);
+		OnShotValidated.Broadcast(InFlightShots[ShotIndex], Hits);
+		for (const FServerSideRewindShotHit& ShotHit : Hits) { KilledCharacters.AddUnique(ShotHit.HitCharacter); }
+	}
+	for (AFirstPersonCharacter* KilledCharacter : KilledCharacters)
+	{
+		KilledCharacter->MulticastRagdoll();
+	}
+
+	/** Shots without a hit that weren't too old count as rejected */
+	int32 NumShotsValidated = 0;
+	for (const FServerSideRewindShotResult& ShotResult : ShotResults)
+	{
+		if (ShotResult.NumHits > 0) { NumShotsValidated++; }
+	}
+	const int32 NumShotsRejected = InFlightShots.Num() - NumShotsValidated - NumShotsTooOld;
+
+	INC_DWORD_STAT_BY(STAT_ServerSideRewindShotsValidated, NumShotsValidated);
+	INC_DWORD_STAT_BY(STAT_ServerSideRewindShotsRejected, NumShotsRejected);
+	INC_DWORD_STAT_BY(STAT_ServerSideRewindShotsTooOld, NumShotsTooOld);
+	CSV_CUSTOM_STAT(ServerSideRewind, ShotsValidated, NumShotsValidated, ECsvCustomStatOp::Accumulate);
+	CSV_CUSTOM_STAT(ServerSideRewind, ShotsRejected, NumShotsRejected, ECsvCustomStatOp::Accumulate);
+	CSV_CUSTOM_STAT(ServerSideRewind, ShotsTooOld, NumShotsTooOld, ECsvCustomStatOp::Accumulate);
+	NumShotsTooOld = 0;
+
+	/** How long the shots waited in the queue, including frames they were deferred for by the budget */
+	const float CurrentTime = GetWorld()->GetTimeSeconds();
+	for (const FServerSideRewindShot& Shot : InFlightShots)
+	{
+		MaxShotDeferral = FMath::Max(MaxShotDeferral, CurrentTime - Shot.QueuedTime);
+	}
+
+	/** Charge the batch to this frame's budget and update the estimate used for sizing the next batches */
+	ValidationCycles += FPlatformTime::Cycles64() - StartCycles;
+	const double BatchSeconds = FPlatformTime::ToSeconds64(ValidationCycles.exchange(0));
+	const double SecondsPerShot = BatchSeconds / InFlightShots.Num();
+	ShotCostEstimate = ShotCostEstimate > 0.0 ? FMath::Lerp(ShotCostEstimate, SecondsPerShot, 0.25) : SecondsPerShot;
+	ShotBudgetSpent += BatchSeconds;
+
+	InFlightShots.Reset();
+	ShotChecks.Reset();
+	ShotGroups.Reset();
+}
+
+int32 UServerSideRewindSubsystem::GetNumShotsWithinBudget() const
+{
+	const double Budget = CVarServerSideRewindShotBudget.GetValueOnGameThread() * 1.0e-6;
+	if (Budget <= 0.0) { return QueuedShots.Num(); }
+
+	/** At least one shot per frame keeps the queue moving, even if a single shot exceeds the budget */
+	const double RemainingBudget = Budget - ShotBudgetSpent;
+	if (RemainingBudget <= 0.0) { return ShotBudgetSpent > 0.0 ? 0 : FMath::Min(QueuedShots.Num(), 1); }
+
+	/** Nothing measured yet, start with a single shot */
+	if (ShotCostEstimate <= 0.0) { return FMath::Min(QueuedShots.Num(), 1); }
+
+	const double NumShots = FMath::Max(FMath::FloorToDouble(RemainingBudget / ShotCostEstimate), ShotBudgetSpent > 0.0 ? 0.0 : 1.0);
+	return static_cast<int32>(FMath::Min(NumShots, static_cast<double>(QueuedShots.Num())));
+}
+
+void UServerSideRewindSubsystem::FallBackOverdueShots()
+{
+	if (QueuedShots.IsEmpty() || !CVarServerSideRewindOverloadFallback.GetValueOnGameThread()) { return; }
+
+	/** Queue is ordered by the time shots were queued at, so overdue shots are at its front */
+	const float Deadline = GetWorld()->GetTimeSeconds() - CVarServerSideRewindMaxShotDeferral.GetValueOnGameThread();
+	int32 NumOverdue = 0;
+	while (NumOverdue < QueuedShots.Num() && QueuedShots[NumOverdue].QueuedTime < Deadline) { NumOverdue++; }
+	if (NumOverdue == 0) { return; }
+
+	/** Same check as without server side rewind, against the hitboxes as they are now */
+	for (int32 Index = 0; Index < NumOverdue; Index++)
+	{
+		const FServerSideRewindShot& Shot = QueuedShots[Index];
+		if (AFirstPersonCharacter* Shooter = GetCharacter(Shot.ShooterSlot)) { Shooter->CheckForKill(Shot.Start, Shot.End); }
+	}
+	QueuedShots.RemoveAt(0, NumOverdue, false);
+
+	UE_LOG(LogServerSideRewind, Verbose, TEXT("Checked %d overdue shots without rewinding"), NumOverdue);
+	INC_DWORD_STAT_BY(STAT_ServerSideRewindShotsFallback, NumOverdue);
+	CSV_CUSTOM_STAT(ServerSideRewind, ShotsWithoutRewind, NumOverdue, ECsvCustomStatOp::Accumulate);
+}
+
+void UServerSideRewindSubsystem::CheckShotGroupAnalytic(const FServerSideRewindShotGroup& ShotGroup)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(ServerSideRewind_CheckShotGroup, ServerSideRewindChannel);
+
+	/** Rewind character to the hit time once for the whole group */
+	FServerSideRewindSnapshot Snapshot;
+	if (!FindSnapshotToCheck(ShotGroup.Slot, ShotGroup.Time, Snapshot)) { return; }
+
+	FServerSideRewindHitBoxBatch Batch;
+	Batch.Build(Snapshot);
+
+	SCOPE_CYCLE_COUNTER(STAT_ServerSideRewindTrace);
+	for (int32 Index = ShotGroup.FirstCheck; Index < ShotGroup.FirstCheck + ShotGroup.NumChecks; Index++)
+	{
+		FServerSideRewindShotCheck& ShotCheck = ShotChecks[Index];
+		const FServerSideRewindShot& Shot = InFlightShots[ShotCheck.ShotIndex];
+		ServerSideRewind::LineTraceHitBoxBatch(Batch, Shot.Start, Shot.End, ShotCheck.HitResult);
+	}
+}
+
+void UServerSideRewindSubsystem::CheckShotGroupPhysics(const FServerSideRewindShotGroup& ShotGroup)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(ServerSideRewind_CheckShotGroup, ServerSideRewindChannel);
+
+	AFirstPersonCharacter* HitCharacter = GetCharacter(ShotGroup.Slot);
+	if (HitCharacter == nullptr || !FindSnapshotToCheck(ShotGroup.Slot, ShotGroup.Time, RewindSnapshot)) { return; }
+
+	/**
+	* Place the hitbox pool once and trace all shots of the group, the character's own hitboxes are never moved.
+	* Collision stays enabled for the next group, CompleteQueuedShots disables it once all groups are checked.
+	*/
+	if (!HitBoxPool.MoveToSnapshot(GetWorld(), RewindSnapshot)) { return; }
+
+	for (int32 Index = ShotGroup.FirstCheck; Index < ShotGroup.FirstCheck + ShotGroup.NumChecks; Index++)
+	{
+		FServerSideRewindShotCheck& ShotCheck = ShotChecks[Index];
+		const FServerSideRewindShot& Shot = InFlightShots[ShotCheck.ShotIndex];
+		UServerSideRewindComponent::TraceRewoundHitBoxes(HitCharacter, HitBoxPool, Shot.Start, Shot.End,
+			ShotCheck.HitResult);
+	}
+}
+
+void UServerSideRewindSubsystem::SortFrameSlots(FServerSideRewindFrame& Frame)
+{
+	/** Reset keeps the allocation, so this only allocates when the amount of characters grows */
+	Frame.SortedSlots.Reset();
+	Frame.MaxBoundsSizeX = 0.0;
+
+	for (int32 Slot = 0; Slot < Frame.Records.Num(); Slot++)
+	{
+		const FServerSideRewindPackedRecord& Record = Frame.Records[Slot];
+		if (Record.IsEmpty()) { continue; }
+
+		Frame.SortedSlots.Add(Slot);
+		Frame.MaxBoundsSizeX = FMath::Max(Frame.MaxBoundsSizeX, static_cast<double>(Record.BoundsMax.X - Record.BoundsMin.X));
+	}
+
+	Frame.SortedSlots.Sort([&Frame](int32 A, int32 B)
+	{
+		return Frame.Records[A].BoundsMin.X < Frame.Records[B].BoundsMin.X;
+	});
+}
+
+bool UServerSideRewindSubsystem::FindFramesToCheck(const FServerSideRewindFrameTime& Time, int32& OutOlderIndex,
+	int32& OutNewerIndex, float& OutAlpha) const
+{
+	if (FrameHistory.IsEmpty()) { return false; }
+
+	UE_LOG(LogServerSideRewind, Verbose, TEXT("Rewinding to frame %d + %.2f (history from frame %d to %d)"), Time.Frame,
+		Time.Alpha, FrameHistory.GetOldest().Time.Frame, FrameHistory.GetNewest().Time.Frame);
+
+	/**
+	* Index of the hit frame follows from its number, a binary search is only needed if frame numbers were skipped.
+	* Frames are interpolated by their actual capture times, which can be anywhere within their frame.
+	*/
+	ServerSideRewindCore::FFrameLookup Lookup;
+	const bool bFound = ServerSideRewindCore::FindFramesToCheck(FrameHistory.Num(),
+		[this](int32 Index) { return FrameHistory[Index].Time; }, Time, Lookup);
+	if (!bFound) { return false; }
+
+	OutOlderIndex = Lookup.OlderIndex;
+	OutNewerIndex = Lookup.NewerIndex;
+	OutAlpha = Lookup.Alpha;
+	return true;
+}
+
+bool UServerSideRewindSubsystem::FindSnapshotToCheck(int32 Slot, const FServerSideRewindFrameTime& Time,
+	FServerSideRewindSnapshot& OutSnapshot) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_ServerSideRewindLookup);
+
+	int32 OlderIndex;
+	int32 NewerIndex;
+	float Alpha;
+	if (!Characters.IsValidIndex(Slot) || !FindFramesToCheck(Time, OlderIndex, NewerIndex, Alpha)) { return false; }
+
+	/** Character wasn't recorded in one of the frames (registered after it was taken) */
+	FServerSideRewindSnapshot OlderSnapshot;
+	FServerSideRewindSnapshot NewerSnapshot;
+	if (!DecodeSnapshot(OlderIndex, Slot, OlderSnapshot)) { return false; }
+	if (NewerIndex != OlderIndex && !DecodeSnapshot(NewerIndex, Slot, NewerSnapshot)) { return false; }
+
+	FServerSideRewindSnapshotPair SnapshotPair;
+	SnapshotPair.Older = &OlderSnapshot;
+	SnapshotPair.Newer = NewerIndex != OlderIndex ? &NewerSnapshot : &OlderSnapshot;
+	SnapshotPair.Alpha = Alpha;
+
+	UServerSideRewindComponent::InterpolateSnapshots(SnapshotPair, OutSnapshot);
+	return true;
+}
+
+bool UServerSideRewindSubsystem::DecodeSnapshot(int32 FrameIndex, int32 Slot,
+	FServerSideRewindSnapshot& OutSnapshot) const
+{
+	const FServerSideRewindFrame& Frame = FrameHistory[FrameIndex];
+	if (!Frame.Records.IsValidIndex(Slot) || Frame.Records[Slot].IsEmpty()) { return false; }
+
+	const FServerSideRewindPackedRecord& Record = Frame.Records[Slot];
+	const FServerSideRewindSlotState& SlotState = SlotStates[Slot];
+	OutSnapshot.Time = Frame.Time;
+	OutSnapshot.NumHitBoxes = Record.NumHitBoxes;
+	OutSnapshot.Bounds = Record.GetBounds();
+	OutSnapshot.bProxy = Record.Encoding == EServerSideRewindRecordEncoding::Proxy;
+
+	/** Proxy records only know the capsule, which is tested as an oriented box */
+	if (OutSnapshot.bProxy)
+	{
+		OutSnapshot.HitBoxLocations[0] = Record.RootLocation;
+		OutSnapshot.HitBoxRotations[0] = ServerSideRewind::UnpackRotation(Record.RootRotation);
+		OutSnapshot.HitBoxExtents[0] = FVector(Frame.Extents[Record.ExtentsIndex]);
+		return true;
+	}
+
+	/**
+	* Walk back to the last frame storing full positions of the character (at most one key frame interval),
+	* rotations come from the last frame actually storing a pose
+	*/
+	int32 KeyIndex = FrameIndex;
+	int32 RotationIndex = INDEX_NONE;
+	while (true)
+	{
+		const EServerSideRewindRecordEncoding Encoding = FrameHistory[KeyIndex].Records[Slot].Encoding;
+		if (RotationIndex == INDEX_NONE && Encoding != EServerSideRewindRecordEncoding::Unchanged) { RotationIndex = KeyIndex; }
+		if (Encoding == EServerSideRewindRecordEncoding::Key) { break; }
+
+		KeyIndex--;
+		if (KeyIndex < 0 || !FrameHistory[KeyIndex].Records.IsValidIndex(Slot) ||
+			FrameHistory[KeyIndex].Records[Slot].IsEmpty() ||
+			FrameHistory[KeyIndex].Records[Slot].Encoding == EServerSideRewindRecordEncoding::Proxy)
+		{
+			return false;
+		}
+	}
+
+	const FServerSideRewindFrame& KeyFrame = FrameHistory[KeyIndex];
+	const FServerSideRewindKeyPositions& KeyPositions = KeyFrame.KeyPositions[KeyFrame.Records[Slot].PositionIndex];
+	const FVector3f* Extents = &KeyFrame.Extents[KeyFrame.Records[Slot].ExtentsIndex];
+
+	int32 Positions[ServerSideRewind::MaxHitBoxes][3];
+	for (int32 Index = 0; Index < Record.NumHitBoxes; Index++)
+	{
+		for (int32 Axis = 0; Axis < 3; Axis++) { Positions[Index][Axis] = KeyPositions.Positions[Index][Axis]; }
+	}
+
+	/** Apply the deltas of all following frames up to the requested one */
+	for (int32 DeltaIndex = KeyIndex + 1; DeltaIndex <= FrameIndex; DeltaIndex++)
+	{
+		const FServerSideRewindFrame& DeltaFrame = FrameHistory[DeltaIndex];
+		if (DeltaFrame.Records[Slot].Encoding != EServerSideRewindRecordEncoding::Delta) { continue; }
+
+		const FServerSideRewindDeltaPositions& DeltaPositions =
+			DeltaFrame.DeltaPositions[DeltaFrame.Records[Slot].PositionIndex];
+
+		for (int32 Index = 0; Index < Record.NumHitBoxes; Index++)
+		{
+			for (int32 Axis = 0; Axis < 3; Axis++) { Positions[Index][Axis] += DeltaPositions.Positions[Index][Axis]; }
+		}
+	}
+
+	const FServerSideRewindFrame& RotationFrame = FrameHistory[RotationIndex];
+	const FServerSideRewindPackedRotations& Rotations =
+		RotationFrame.Rotations[RotationFrame.Records[Slot].RotationIndex];
+
+	if (SlotState.HitBoxLayout == INDEX_NONE)
+	{
+		for (int32 Index = 0; Index < Record.NumHitBoxes; Index++)
+		{
+			OutSnapshot.HitBoxLocations[Index] = ServerSideRewind::DequantizePosition(Positions[Index], Record.RootLocation);
+			OutSnapshot.HitBoxRotations[Index] = ServerSideRewind::UnpackRotation(Rotations.Rotations[Index]);
+			OutSnapshot.HitBoxExtents[Index] = FVector(Extents[Index]);
+		}
+		return true;
+	}
+
+	/** Reconstruct the hitboxes from the bone transforms (characters are expected not to be scaled) */
+	const FServerSideRewindHitBoxLayout& Layout = HitBoxLayouts[SlotState.HitBoxLayout];
+	const FTransform MeshToWorld = Layout.MeshTransform *
+		FTransform(ServerSideRewind::UnpackRotation(Record.RootRotation), Record.RootLocation);
+
+	for (int32 Index = 0; Index < Record.NumHitBoxes; Index++)
+	{
+		const FTransform BoneTransform(ServerSideRewind::UnpackRotation(Rotations.Rotations[Index]),
+			ServerSideRewind::DequantizePosition(Positions[Index], FVector::ZeroVector));
+		const FTransform HitBoxTransform = Layout.HitBoxTransforms[Index] * BoneTransform * MeshToWorld;
+
+		OutSnapshot.HitBoxLocations[Index] = HitBoxTransform.GetLocation();
+		OutSnapshot.HitBoxRotations[Index] = HitBoxTransform.GetRotation();
+		OutSnapshot.HitBoxExtents[Index] = FVector(Extents[Index]);
+	}
+	return true;
+}
+
+void UServerSideRewindSubsystem::GetHistoryMemoryUsage(SIZE_T& OutPackedBytes, SIZE_T& OutUnpackedBytes) const
+{
+	OutPackedBytes = HistoryPackedBytes;
+	OutUnpackedBytes = HistoryUnpackedBytes;
+}
+
+void UServerSideRewindSubsystem::FindCandidates(const FServerSideRewindFrameTime& Time, const FVector& Start,
+	const FVector& End, TArray<int32>& OutSlots) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_ServerSideRewindBroadphase);
+
+	OutSlots.Reset();
+
+	int32 OlderIndex;
+	int32 NewerIndex;
+	float Alpha;
+	if (!FindFramesToCheck(Time, OlderIndex, NewerIndex, Alpha)) { return; }
+
+	/** Characters move between the two frames, so a hit in either frame makes them a candidate */
+	FindCandidatesInFrame(FrameHistory[OlderIndex], Start, End, OutSlots);
+	if (NewerIndex != OlderIndex) { FindCandidatesInFrame(FrameHistory[NewerIndex], Start, End, OutSlots); }
+}
+
+void UServerSideRewindSubsystem::FindCandidatesInFrame(const FServerSideRewindFrame& Frame, const FVector& Start,
+	const FVector& End, TArray<int32>& OutSlots) const
+{
+	const double LineMinX = FMath::Min(Start.X, End.X);
+	const double LineMaxX = FMath::Max(Start.X, End.X);
+	const FVector Direction = End - Start;
+
+	/** Binary search for the first slot whose bounds start after the line ends on the X axis */
+	int32 Low = 0;
+	int32 High = Frame.SortedSlots.Num();
+	while (Low < High)
+	{
+		const int32 Middle = Low + (High - Low) / 2;
+		if (Frame.Records[Frame.SortedSlots[Middle]].BoundsMin.X <= LineMaxX) { Low = Middle + 1; }
+		else { High = Middle; }
+	}
+
+	/** Sweep back until no bounds can reach the line anymore */
+	for (int32 Index = Low - 1; Index >= 0; Index--)
+	{
+		const int32 Slot = Frame.SortedSlots[Index];
+		const FBox Bounds = Frame.Records[Slot].GetBounds();
+		if (Bounds.Min.X < LineMinX - Frame.MaxBoundsSizeX) { break; }
+
+		if (Bounds.Max.X >= LineMinX && FMath::LineBoxIntersection(Bounds, Start, End, Direction))
+		{
+			OutSlots.AddUnique(Slot);
+		}
+	}
+}
+
+bool UServerSideRewindSubsystem::SweepSphere(int32 ShooterSlot, const FServerSideRewindFrameTime& StartTime,
+	const FServerSideRewindFrameTime& EndTime, const FVector& Start, const FVector& End, float Radius,
+	FServerSideRewindSweepResult& OutResult)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ServerSideRewindSweep);
+
+	OutResult = FServerSideRewindSweepResult();
+	if (FrameHistory.IsEmpty() || EndTime < StartTime || EndTime < FrameHistory.GetOldest().Time)
+	{
+		return false;
+	}
+
+	/** Location of the sphere at a time of the flight (the whole line at once without a time range) */
+	const float Duration = EndTime.FramesSince(StartTime);
+	const auto GetLocation = [&](const FServerSideRewindFrameTime& Time, const FVector& Fallback)
+	{
+		return Duration > 0.0f ? FMath::Lerp(Start, End, FMath::Clamp(Time.FramesSince(StartTime) / Duration, 0.0f, 1.0f)) :
+			Fallback;
+	};
+
+	/** Part of the flight before the oldest frame can't be checked anymore */
+	const FServerSideRewindFrameTime& OldestTime = FrameHistory.GetOldest().Time;
+	FServerSideRewindFrameTime StepStart = StartTime < OldestTime ? OldestTime : StartTime;
+
+	/** Step from frame to frame, every step ends at the next recorded frame or at the end of the flight */
+	while (true)
+	{
+		int32 OlderIndex;
+		int32 NewerIndex;
+		float Alpha;
+		if (!FindFramesToCheck(StepStart, OlderIndex, NewerIndex, Alpha)) { return false; }
+
+		FServerSideRewindFrameTime StepEnd = EndTime;
+		const FServerSideRewindFrameTime& NextFrameTime = FrameHistory[NewerIndex].Time;
+		if (NewerIndex != OlderIndex && NextFrameTime < EndTime) { StepEnd = NextFrameTime; }
+
+		if (SweepSphereStep(ShooterSlot, OlderIndex, NewerIndex, StepStart, StepEnd, GetLocation(StepStart, Start),
+			GetLocation(StepEnd, End), Radius, OutResult))
+		{
+			/** Distance along the whole path instead of the step */
+			OutResult.HitResult.Distance = FVector::Dist(Start, OutResult.HitResult.ImpactPoint);
+			return true;
+		}
+
+		if (!(StepEnd < EndTime)) { return false; }
+		StepStart = StepEnd;
+	}
+}
+
+bool UServerSideRewindSubsystem::SweepSphereStep(int32 ShooterSlot, int32 OlderIndex, int32 NewerIndex,
+	const FServerSideRewindFrameTime& StepStart, const FServerSideRewindFrameTime& StepEnd, const FVector& Start,
+	const FVector& End, float Radius, FServerSideRewindSweepResult& OutResult)
+{
+	const FServerSideRewindFrame& OlderFrame = FrameHistory[OlderIndex];
+	const FServerSideRewindFrame& NewerFrame = FrameHistory[NewerIndex];
+
+	/**
+	* Early out, a character interpolated between the two frames stays within the union of its bounds in both,
+	* so the segment has to touch that box grown by the radius
+	*/
+	SweepCandidateSlots.Reset();
+	const FVector Direction = End - Start;
+	const FBox StepBounds = FBox(Start.ComponentMin(End), Start.ComponentMax(End)).ExpandBy(Radius);
+	for (const int32 Slot : OlderFrame.SortedSlots)
+	{
+		if (Slot == ShooterSlot || !NewerFrame.Records.IsValidIndex(Slot) || NewerFrame.Records[Slot].IsEmpty())
+		{
+			continue;
+		}
+
+		const FBox Bounds = (OlderFrame.Records[Slot].GetBounds() + NewerFrame.Records[Slot].GetBounds()).ExpandBy(Radius);
+		if (Bounds.Intersect(StepBounds) && FMath::LineBoxIntersection(Bounds, Start, End, Direction))
+		{
+			SweepCandidateSlots.Add(Slot);
+		}
+	}
+	if (SweepCandidateSlots.IsEmpty()) { return false; }
+
+	/** Hitboxes move during the step too, they are posed at its middle */
+	const FServerSideRewindFrameTime MiddleTime = FServerSideRewindFrameTime::Lerp(StepStart, StepEnd, 0.5f);
+	FServerSideRewindSnapshot Snapshot;
+	FServerSideRewindHitBoxBatch Batch;
+	int32 HitSlot = INDEX_NONE;
+	for (const int32 Slot : SweepCandidateSlots)
+	{
+		if (!FindSnapshotToCheck(Slot, MiddleTime, Snapshot)) { continue; }
+
+		Batch.Build(Snapshot, Radius);
+		FServerSideRewindHitResult HitResult;
+		if (ServerSideRewind::LineTraceHitBoxBatch(Batch, Start, End, HitResult) &&
+			(HitSlot == INDEX_NONE || HitResult.Distance < OutResult.HitResult.Distance))
+		{
+			HitSlot = Slot;
+			OutResult.HitResult = HitResult;
+		}
+	}
+	if (HitSlot == INDEX_NONE) { return false; }
+
+	/** Closest along the segment is also the first in time, the sphere moves along it at a constant speed */
+	const double Length = Direction.Size();
+	const float StepFraction = Length > 0.0 ? static_cast<float>(OutResult.HitResult.Distance / Length) : 0.0f;
+	OutResult.Time = FServerSideRewindFrameTime::Lerp(StepStart, StepEnd, StepFraction);
+	OutResult.HitCharacter = Characters[HitSlot];
+
+	if (OutResult.HitCharacter != nullptr &&
+		OutResult.HitCharacter->HitBoxBoneNames.IsValidIndex(OutResult.HitResult.HitBoxIndex))
+	{
+		OutResult.HitResult.BoneName = OutResult.HitCharacter->HitBoxBoneNames[OutResult.HitResult.HitBoxIndex];
+	}
+	return true;
+}
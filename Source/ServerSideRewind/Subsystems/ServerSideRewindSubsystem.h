@@ -0,0 +1,522 @@
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tasks/Task.h"
+#include <atomic>
+#include "ServerSideRewind/Components/ServerSideRewindComponent.h"
+#include "ServerSideRewind/Components/ServerSideRewindCompression.h"
+#include "ServerSideRewind/Components/ServerSideRewindFrameTime.h"
+#include "ServerSideRewind/Components/ServerSideRewindHitBoxPool.h"
+#include "ServerSideRewind/Components/ServerSideRewindRingBuffer.h"
+#include "ServerSideRewindSubsystem.generated.h"
+
+
+class AFirstPersonCharacter;
+class AGameStateBase;
+
+
+/**
+* Frame of the shared server side rewind history.
+* Holds one packed record per character slot, all taken at the same time.
+* Hitbox positions are quantized relative to the actor root. Key frames store them in full,
+* the frames in between store them as deltas to the previous frame if they fit into 8 bits.
+* Characters whose hitboxes barely moved since their last stored pose only store an unchanged marker.
+*/
+struct FServerSideRewindFrame
+{
+	/** Server time the records were taken at, the frame number plus how far into it the tick was */
+	FServerSideRewindFrameTime Time;
+
+	/** Stores full positions of every character, the oldest frame in the history is always a key frame */
+	bool bKeyFrame = false;
+
+	/** Records indexed by character slot (empty for free slots) */
+	TArray<FServerSideRewindPackedRecord> Records;
+
+	/** Positions of the records using key encoding */
+	TArray<FServerSideRewindKeyPositions> KeyPositions;
+
+	/** Positions of the records using delta encoding */
+	TArray<FServerSideRewindDeltaPositions> DeltaPositions;
+
+	/** Rotations of all records storing a pose */
+	TArray<FServerSideRewindPackedRotations> Rotations;
+
+	/** Hitbox extents of the key records (one per hitbox) and proxy records (one for the proxy box) */
+	TArray<FVector3f> Extents;
+
+	/** Slots of all recorded characters sorted by the min X of their bounds (sweep broadphase) */
+	TArray<int32> SortedSlots;
+
+	/** Largest X size of all bounds in this frame, limits how far back the sweep has to look */
+	double MaxBoundsSizeX = 0.0;
+
+	FORCEINLINE SIZE_T GetAllocatedSize() const
+	{
+		return Records.GetAllocatedSize() + KeyPositions.GetAllocatedSize() + DeltaPositions.GetAllocatedSize() +
+			Rotations.GetAllocatedSize() + Extents.GetAllocatedSize() + SortedSlots.GetAllocatedSize();
+	}
+
+	/** Memory the frame would use storing a full snapshot per record instead, for comparison with the packed size */
+	FORCEINLINE SIZE_T GetUnpackedSize() const
+	{
+		return sizeof(FServerSideRewindFrame) + SortedSlots.GetAllocatedSize() +
+			Records.Num() * sizeof(FServerSideRewindSnapshot);
+	}
+};
+
+/**
+* Fidelity a character is recorded with, depending on how likely it is to be shot.
+* Ordered from the highest to the lowest fidelity.
+*/
+enum class EServerSideRewindLOD : uint8
+{
+	/** Close to another character or in its view, every hitbox is recorded every frame */
+	Full,
+	/** Far away but possibly visible, the hitboxes are only recorded every few frames */
+	Reduced,
+	/** Far away from and not in view of every other character, only a capsule sized proxy box is recorded */
+	Proxy,
+	Num
+};
+
+/**
+* Counters showing how much every LOD costs.
+*/
+struct FServerSideRewindLODStats
+{
+	/** Characters in every LOD when the last frame was saved */
+	int32 NumCharacters[static_cast<int32>(EServerSideRewindLOD::Num)] = {};
+
+	/** Records and bytes stored for characters in every LOD since the history was initialized */
+	int64 NumRecords[static_cast<int32>(EServerSideRewindLOD::Num)] = {};
+	int64 NumBytes[static_cast<int32>(EServerSideRewindLOD::Num)] = {};
+};
+
+/**
+* Per character data which isn't stored in every frame.
+*/
+struct FServerSideRewindSlotState
+{
+	/** Hitbox layout of the character's class if bone transforms are recorded for it (INDEX_NONE if not) */
+	int32 HitBoxLayout = INDEX_NONE;
+
+	EServerSideRewindLOD LOD = EServerSideRewindLOD::Full;
+
+	/** Frames the last pose has been reused for at the reduced LOD */
+	int32 NumReusedFrames = 0;
+
+	/** Bounds of the last stored pose relative to the root, moved along with the root while reusing the pose */
+	FVector3f LastBoundsMin = FVector3f::ZeroVector;
+	FVector3f LastBoundsMax = FVector3f::ZeroVector;
+
+	/** Last pose stored in the history, deltas and unchanged markers of the next frame are relative to it */
+	FServerSideRewindKeyPositions LastPositions;
+	FServerSideRewindPackedRotations LastRotations;
+	FVector3f LastExtents[ServerSideRewind::MaxHitBoxes];
+	int32 LastNumHitBoxes = 0;
+
+	/** Snapshot taken this frame and its encoded pose, copied into the frame after capturing */
+	FServerSideRewindSnapshot CapturedSnapshot;
+	FServerSideRewindKeyPositions CapturedPositions;
+	FServerSideRewindDeltaPositions CapturedDelta;
+	FServerSideRewindPackedRotations CapturedRotations;
+
+	/** Extents of the hitboxes (or of the proxy box) captured this frame */
+	FVector3f CapturedExtents[ServerSideRewind::MaxHitBoxes];
+};
+
+
+/**
+* Shot waiting to be checked for kill using server side rewind.
+*/
+struct FServerSideRewindShot
+{
+	/** Slot of the character who fired the shot (can't kill itself) */
+	int32 ShooterSlot = INDEX_NONE;
+
+	FServerSideRewindFrameTime Time;
+	FVector Start = FVector::ZeroVector;
+	FVector End = FVector::ZeroVector;
+
+	/** World time the shot was queued at, used for measuring how long it was deferred */
+	float QueuedTime = 0.0f;
+
+	/** Amount of characters the shot can hit along its line (more than one for penetrating weapons) */
+	int32 MaxHits = 1;
+};
+
+/**
+* Character a queued shot has to be checked against, found by the broadphase.
+*/
+struct FServerSideRewindShotCheck
+{
+	int32 ShotIndex = INDEX_NONE;
+	int32 Slot = INDEX_NONE;
+	FServerSideRewindFrameTime Time;
+
+	/** Result of checking the shot against the character (written by exactly one shot group) */
+	FServerSideRewindHitResult HitResult;
+};
+
+/**
+* Checks of the same character at the same hit time, sharing one rewound pose.
+*/
+struct FServerSideRewindShotGroup
+{
+	int32 Slot = INDEX_NONE;
+	FServerSideRewindFrameTime Time;
+	int32 FirstCheck = 0;
+	int32 NumChecks = 0;
+};
+
+/**
+* Character hit by a validated shot, with the hitbox the shot entered it through.
+*/
+struct FServerSideRewindShotHit
+{
+	int32 ShotIndex = INDEX_NONE;
+	AFirstPersonCharacter* HitCharacter = nullptr;
+	FServerSideRewindHitResult HitResult;
+};
+
+/**
+* Hits of a validated shot, ordered by distance along the line and limited to the shot's MaxHits.
+* Points into the subsystem's array of hits of the batch.
+*/
+struct FServerSideRewindShotResult
+{
+	int32 FirstHit = 0;
+	int32 NumHits = 0;
+};
+
+/** Broadcast on the server for every validated shot hitting at least one character, before the hit characters are killed */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnServerSideRewindShotValidated, const FServerSideRewindShot& /* Shot */,
+	TArrayView<const FServerSideRewindShotHit> /* Hits */);
+
+
+/**
+* World subsystem recording the hitboxes of every registered character in one pass per frame.
+* Runs on the server only, after all tick groups (so after physics and animation) have finished.
+*
+* Also checks all shots queued during the frame for kills in one batched pass. Shots received before the
+* actors tick are dispatched as tasks running in parallel with the rest of the frame and joined in Tick,
+* before the new frame is recorded and before replication. The frame history is therefore never written
+* while validation tasks are reading it, and shots queued while validating go into a second buffer.
+*
+* Frames are numbered on a fixed-rate grid (ServerSideRewind.FrameRate) shared with the clients, which report
+* hit times as frame number plus fraction. Hit frames are found by indexing the history with the frame number.
+*
+* Validation is limited to a time budget per frame (ServerSideRewind.ShotBudget). Shots over budget stay queued
+* with their original hit time and are validated in one of the next frames against the same historical frames.
+*/
+UCLASS()
+class SERVERSIDEREWIND_API UServerSideRewindSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+	/** Adds character to the recorded characters and returns its slot in every frame */
+	int32 RegisterCharacter(AFirstPersonCharacter* Character);
+
+	/** Removes character from the recorded characters and clears its slot in the history */
+	void UnregisterCharacter(int32 Slot);
+
+	/**
+	* Finds the snapshots of the character in the specified slot right before and after the hit time
+	* and interpolates between them. Indexes the frame history by frame number and only decodes these two frames.
+	* Returns false if the character wasn't recorded at the hit time.
+	*/
+	bool FindSnapshotToCheck(int32 Slot, const FServerSideRewindFrameTime& Time,
+		FServerSideRewindSnapshot& OutSnapshot) const;
+
+	/** Decodes the snapshot of the character in the specified slot from the frame at the specified history index */
+	bool DecodeSnapshot(int32 FrameIndex, int32 Slot, FServerSideRewindSnapshot& OutSnapshot) const;
+
+	/**
+	* Memory used by the recorded frames, compared to storing one full snapshot per character and frame.
+	* Used by the ServerSideRewind.MemoryReport console command and the memory stat.
+	*/
+	void GetHistoryMemoryUsage(SIZE_T& OutPackedBytes, SIZE_T& OutUnpackedBytes) const;
+
+	/**
+	* Finds the slots of all characters whose bounds the line could have touched at the hit time.
+	* Only these candidates need to be tested against their individual hitboxes.
+	*/
+	void FindCandidates(const FServerSideRewindFrameTime& Time, const FVector& Start, const FVector& End,
+		TArray<int32>& OutSlots) const;
+
+	/**
+	* Queues shot to be checked for kill at the end of the frame.
+	* The shot kills up to MaxHits characters along its line, closest first.
+	*/
+	void QueueShot(int32 ShooterSlot, const FServerSideRewindFrameTime& Time, const FVector& Start, const FVector& End,
+		int32 MaxHits = 1);
+
+	/**
+	* Sweeps a sphere moving from Start at StartTime to End at EndTime through the history and returns the first
+	* character it hits (not the one in ShooterSlot), with the time of impact and the hit bone.
+	* The flight is split into steps at every recorded frame in between. Characters whose bounds in the frames around
+	* a step, grown by the radius, miss the step's segment are skipped, the others are rewound to the middle of the step.
+	* The part of the flight older than the history isn't checked. Game thread only.
+	*/
+	bool SweepSphere(int32 ShooterSlot, const FServerSideRewindFrameTime& StartTime,
+		const FServerSideRewindFrameTime& EndTime, const FVector& Start, const FVector& End, float Radius,
+		FServerSideRewindSweepResult& OutResult);
+
+	/**
+	* Hit bone, impact point and distance of every character hit by a validated shot, e.g. for damage multipliers.
+	* Found by the same pass over the rewound frame that validates the shot, so no further trace is needed.
+	*/
+	FOnServerSideRewindShotValidated OnShotValidated;
+
+	/** Character registered in the specified slot (nullptr if free) */
+	FORCEINLINE AFirstPersonCharacter* GetCharacter(int32 Slot) const
+	{
+		return Characters.IsValidIndex(Slot) ? Characters[Slot] : nullptr;
+	}
+
+	/** Amount of character slots in every frame (including free ones) */
+	FORCEINLINE int32 GetNumSlots() const { return Characters.Num(); }
+
+	/** Boxes the physics hit test places at the rewound hitboxes */
+	FORCEINLINE FServerSideRewindHitBoxPool& GetHitBoxPool() { return HitBoxPool; }
+
+	FORCEINLINE float GetMaxRewindTime() const { return MaxRewindTime; }
+
+	/** Frames per second of the frame numbers in the history */
+	FORCEINLINE float GetFrameRate() const { return FrameRate; }
+
+	/** Changes how far back shots can be rewound, resizes the frame history and drops the frames recorded so far */
+	void SetMaxRewindTime(float InMaxRewindTime);
+
+	FORCEINLINE const FServerSideRewindLODStats& GetLODStats() const { return LODStats; }
+
+	/** LOD the character in the slot was recorded with in the newest frame */
+	FORCEINLINE EServerSideRewindLOD GetLOD(int32 Slot) const { return SlotStates[Slot].LOD; }
+
+	/** Frames going back as far as MaxRewindTime allows, ordered from oldest to newest */
+	FORCEINLINE const TServerSideRewindRingBuffer<FServerSideRewindFrame>& GetFrameHistory() const
+	{
+		return FrameHistory;
+	}
+
+protected:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/** Recorded characters indexed by their slot (nullptr for free slots) */
+	UPROPERTY()
+	TArray<AFirstPersonCharacter*> Characters;
+
+	/** Slots of unregistered characters available for reuse */
+	TArray<int32> FreeSlots;
+
+	/** Data of every character slot not stored per frame */
+	TArray<FServerSideRewindSlotState> SlotStates;
+
+	/** Hitbox layouts shared by all characters of the same class */
+	TArray<FServerSideRewindHitBoxLayout> HitBoxLayouts;
+
+	/** Index of the hitbox layout of every registered character class (INDEX_NONE if it has none) */
+	TMap<const UClass*, int32> HitBoxLayoutIndices;
+
+	/** Amount of frames saved so far (used for spacing key frames) */
+	uint32 NumSavedFrames = 0;
+
+	/** Shots of the current batch older than the history (counted for the stats) */
+	int32 NumShotsTooOld = 0;
+
+	/** World time the last shot was queued at, frames are saved every tick for a while after it */
+	float LastShotTime = -UE_BIG_NUMBER;
+
+	/** Max quantized difference to the last stored pose for reusing it (updated from the cvars every frame) */
+	int32 UnchangedPositionThreshold = 0;
+	int32 UnchangedRotationThreshold = 0;
+
+	/** Amount of frames a pose is used for at the reduced LOD (updated from the cvar every frame) */
+	int32 ReducedRecordInterval = 1;
+
+	FServerSideRewindLODStats LODStats;
+
+	/** View of every character slot used for updating the LODs (reused to avoid allocating every frame) */
+	TArray<FVector> ViewLocations;
+	TArray<FVector> ViewDirections;
+
+	/** First slot of the next slice of characters that may be demoted */
+	int32 NextLODSlot = 0;
+
+	/** Game state (used for getting server time) */
+	UPROPERTY()
+	AGameStateBase* GameState;
+
+	/** Shared frame history, preallocated in OnWorldBeginPlay (server only) */
+	TServerSideRewindRingBuffer<FServerSideRewindFrame> FrameHistory;
+
+	/** Memory used by the frames in the history, packed and as full snapshots (updated when frames are added or removed) */
+	SIZE_T HistoryPackedBytes = 0;
+	SIZE_T HistoryUnpackedBytes = 0;
+
+	/** Shots queued since the last dispatch and shots deferred by the budget, oldest first */
+	TArray<FServerSideRewindShot> QueuedShots;
+
+	/** Shots currently being validated (swapped with QueuedShots on dispatch) */
+	TArray<FServerSideRewindShot> InFlightShots;
+
+	/** Broadphase results of the shots being validated, grouped by character slot and hit time */
+	TArray<FServerSideRewindShotCheck> ShotChecks;
+
+	/** Groups of checks sharing one rewound pose */
+	TArray<FServerSideRewindShotGroup> ShotGroups;
+
+	/** Tasks validating the shot groups */
+	TArray<UE::Tasks::FTask> ValidationTasks;
+
+	/** Whether the shot groups are validated by tasks or on the game thread when completing them */
+	bool bValidatingWithTasks = false;
+
+	/** Cycles spent validating the shots in flight, summed over all threads */
+	std::atomic<uint64> ValidationCycles = 0;
+
+	/** Seconds it takes to validate one shot, smoothed over the last batches (0 until the first is measured) */
+	double ShotCostEstimate = 0.0;
+
+	/** Seconds of the shot budget spent this frame */
+	double ShotBudgetSpent = 0.0;
+
+	/** Longest time a shot completed this frame was queued for (for the stats) */
+	float MaxShotDeferral = 0.0f;
+
+	/** Hits of every shot being validated */
+	TArray<FServerSideRewindShotResult> ShotResults;
+
+	/** Hits of all shots being validated, sorted by shot and distance */
+	TArray<FServerSideRewindShotHit> ShotHits;
+
+	/** Characters killed by the validated shots */
+	TArray<AFirstPersonCharacter*> KilledCharacters;
+
+	/** Broadphase result of a single shot (reused to avoid allocating on every check) */
+	TArray<int32> CandidateSlots;
+
+	/** Broadphase result of one step of a sweep (reused to avoid allocating on every step) */
+	TArray<int32> SweepCandidateSlots;
+
+	/** Handle of the OnWorldPreActorTick delegate used for dispatching shots */
+	FDelegateHandle PreActorTickHandle;
+
+	/** Snapshot the hitboxes are rewound to (reused to avoid allocating on every check) */
+	FServerSideRewindSnapshot RewindSnapshot;
+
+	/** Boxes placed at the rewound hitboxes by the physics hit test, instead of moving the characters' own ones */
+	UPROPERTY()
+	FServerSideRewindHitBoxPool HitBoxPool;
+
+	/**
+	* Max amount of seconds to go back in time.
+	* Hit times are clamped to the measured latency of the shooter's connection, so this only has to cover the worst one.
+	*/
+	float MaxRewindTime = 1.0f;
+
+	/** ServerSideRewind.FrameRate the history was allocated for, changing it drops the history */
+	float FrameRate = 60.0f;
+
+	/** Allocates the frame history based on MaxRewindTime and the frame rate */
+	void InitFrameHistory();
+
+	/** Saves snapshot of every registered character into a new frame */
+	void SaveServerSideRewindFrame();
+
+	/** Removes the oldest frame from the history */
+	void PopOldestFrame();
+
+	/** Whether a frame has to be saved this tick (base rate without recent shots, every frame number with them) */
+	bool ShouldSaveFrame(int32 FrameNumber) const;
+
+	/**
+	* Picks the LOD of every character based on the distance to the closest other character
+	* and whether it's within the view of any of them. Promotion happens in the same frame,
+	* demotions are spread over ServerSideRewind.LOD.UpdateFrames frames.
+	*/
+	void UpdateLODs();
+
+	/** Takes snapshot of the character in the slot and encodes it into its record of the frame (any thread) */
+	void CaptureSlot(FServerSideRewindFrame& Frame, int32 Slot);
+
+	/** Records the capsule of the character as a single proxy box */
+	void CaptureProxy(FServerSideRewindFrame& Frame, int32 Slot);
+
+	/** Captures the world transforms of the hitbox components, returns the amount of hitboxes */
+	int32 CaptureHitBoxTransforms(FServerSideRewindFrame& Frame, int32 Slot);
+
+	/** Captures the component space transforms of the bones the hitboxes are attached to, returns the amount of hitboxes */
+	int32 CaptureBoneTransforms(FServerSideRewindFrame& Frame, int32 Slot);
+
+	/** Finds the hitbox layout of the character's class, builds it for the first character of every class */
+	int32 FindHitBoxLayout(AFirstPersonCharacter* Character);
+
+	/** Removes frames older than MaxRewindTime, keeping the oldest frame a key frame */
+	void EvictOldFrames();
+
+	/** Dispatches shots received this frame right before the actors tick */
+	void OnWorldPreActorTick(UWorld* InWorld, ELevelTick TickType, float DeltaTime);
+
+	/**
+	* Runs the broadphase for the oldest queued shots fitting into the shot budget and groups the checks by
+	* character and hit time, so every rewound pose is built only once. Analytic checks are launched as tasks.
+	*/
+	void DispatchQueuedShots();
+
+	/** Waits for the validation tasks, validates remaining groups on the game thread and kills hit characters */
+	void CompleteQueuedShots();
+
+	/** Waits for the validation tasks without completing the shots */
+	void WaitForValidationTasks();
+
+	/** Amount of the oldest queued shots the rest of this frame's shot budget is estimated to cover */
+	int32 GetNumShotsWithinBudget() const;
+
+	/**
+	* Checks shots waiting longer than ServerSideRewind.MaxShotDeferral against the current hitboxes without
+	* rewinding them (only with ServerSideRewind.OverloadFallback enabled).
+	*/
+	void FallBackOverdueShots();
+
+	/**
+	* Checks all shots of the group against the analytically rewound character.
+	* Only reads the frame history and writes the checks of the group, so it's safe to run on any thread.
+	*/
+	void CheckShotGroupAnalytic(const FServerSideRewindShotGroup& ShotGroup);
+
+	/** Moves the hitboxes of the character once and checks all shots of the group (game thread only) */
+	void CheckShotGroupPhysics(const FServerSideRewindShotGroup& ShotGroup);
+
+	/** Sorts the recorded slots of the frame for the sweep broadphase */
+	void SortFrameSlots(FServerSideRewindFrame& Frame);
+
+	/**
+	* Finds the frames right before and after the hit time.
+	* Returns false if the hit time is older than the frame history.
+	*/
+	bool FindFramesToCheck(const FServerSideRewindFrameTime& Time, int32& OutOlderIndex, int32& OutNewerIndex,
+		float& OutAlpha) const;
+
+	/**
+	* Checks one step of a sphere sweep between the frames at the history indices, against the characters rewound to
+	* the middle of the step. Returns the closest hit along the step's segment.
+	*/
+	bool SweepSphereStep(int32 ShooterSlot, int32 OlderIndex, int32 NewerIndex,
+		const FServerSideRewindFrameTime& StepStart, const FServerSideRewindFrameTime& StepEnd, const FVector& Start,
+		const FVector& End, float Radius, FServerSideRewindSweepResult& OutResult);
+
+	/** Adds the slots of all characters in the frame whose bounds intersect the line */
+	void FindCandidatesInFrame(const FServerSideRewindFrame& Frame, const FVector& Start, const FVector& End,
+		TArray<int32>& OutSlots) const;
+};
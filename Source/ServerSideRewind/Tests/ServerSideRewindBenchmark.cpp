@@ -0,0 +1,440 @@
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "GameFramework/GameStateBase.h"
+#include "GameFramework/WorldSettings.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformTime.h"
+#include "Math/RandomStream.h"
+#include "ServerSideRewind/Character/FirstPersonCharacter.h"
+#include "ServerSideRewind/Components/ServerSideRewindComponent.h"
+#include "ServerSideRewind/Components/ServerSideRewindHitTest.h"
+#include "ServerSideRewind/Subsystems/ServerSideRewindSubsystem.h"
+
+
+namespace ServerSideRewindBenchmark
+{
+	/** Server tick the history is recorded at */
+	constexpr float DeltaTime = 1.0f / 60.0f;
+
+	/** Extra seconds simulated after the history is full, used for measuring the steady state */
+	constexpr float SteadyStateTime = 1.0f;
+
+	constexpr int32 NumShots = 2000;
+
+	/** Shots queued per validating tick, like the shots of several players received during one frame */
+	constexpr int32 ShotsPerBatch = 32;
+
+	/** Share of the shots aimed next to the character instead of at one of its hitboxes */
+	constexpr float MissRatio = 0.25f;
+
+	/**
+	* Max share of the shots at fully recorded characters allowed to disagree with the ground truth
+	* (quantization right at a box edge)
+	*/
+	constexpr double MaxMismatchRatio = 0.01;
+
+	/** Characters crowded within ServerSideRewind.LOD.FullDistance of each other, everyone is recorded in full */
+	constexpr float DenseGridSpacing = 400.0f;
+
+	/** Characters spread past the LOD distances, so the reduced and proxy LODs are recorded as well */
+	constexpr float SpreadGridSpacing = 12000.0f;
+
+	constexpr float CircleRadius = 150.0f;
+
+	/** Character class the game spawns, its hitboxes are attached to the bones of the mannequin */
+	const TCHAR* CharacterClassPath = TEXT("/Game/Blueprints/Character/BP_FirstPersonCharacter.BP_FirstPersonCharacter_C");
+
+	/** Scripted movement, every character runs in a circle around its grid cell while turning */
+	FTransform GetScriptedTransform(int32 Index, int32 GridSize, float GridSpacing, float Time)
+	{
+		const float Phase = Index * 0.7f;
+		const FVector Center((Index % GridSize) * GridSpacing, (Index / GridSize) * GridSpacing, 100.0f);
+		const FVector Offset(FMath::Cos(2.0f * Time + Phase) * CircleRadius,
+			FMath::Sin(2.0f * Time + Phase) * CircleRadius, 0.0f);
+		const FRotator Rotation(0.0f, FMath::Fmod(Time * 90.0f + Phase * 60.0f, 360.0f), 0.0f);
+		return FTransform(Rotation, Center + Offset);
+	}
+
+	/** Time spent in one operation accumulated over a run */
+	struct FTiming
+	{
+		double TotalSeconds = 0.0;
+		double MaxSeconds = 0.0;
+		int32 Count = 0;
+
+		void Add(double Seconds)
+		{
+			TotalSeconds += Seconds;
+			MaxSeconds = FMath::Max(MaxSeconds, Seconds);
+			Count++;
+		}
+
+		double GetAverageMicroseconds() const { return Count > 0 ? TotalSeconds / Count * 1.0e6 : 0.0; }
+		double GetMaxMicroseconds() const { return MaxSeconds * 1.0e6; }
+	};
+
+	double GetUsedPhysicalKilobytes()
+	{
+		return FPlatformMemory::GetStats().UsedPhysical / 1024.0;
+	}
+}
+
+/**
+* Headless benchmark of the whole server side rewind pipeline (runs with -nullrhi).
+* Spawns the game's character Blueprint moving along scripted paths, so the bone transforms are recorded and
+* the hitboxes reconstructed from them like in the game. Records the history through the subsystem and fires
+* synthetic shots through UServerSideRewindSubsystem::QueueShot, validated in batches by ticking the subsystem.
+* Reports the time spent recording, looking up and validating, the memory used, the share of every LOD and how many
+* shots hit the same character and hitbox as a trace against the hitboxes as they actually were at the hit time.
+* Parameters are the amount of characters, the max rewind time in seconds and the spacing of the characters in cm.
+*/
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FServerSideRewindBenchmark, "ServerSideRewind.Benchmark",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+void FServerSideRewindBenchmark::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	const int32 PlayerCounts[] = { 8, 32, 100 };
+	const float HistoryLengths[] = { 1.0f, 3.0f };
+
+	for (const int32 NumPlayers : PlayerCounts)
+	{
+		for (const float HistoryLength : HistoryLengths)
+		{
+			OutBeautifiedNames.Add(FString::Printf(TEXT("%d Players %.0fs History"), NumPlayers, HistoryLength));
+			OutTestCommands.Add(FString::Printf(TEXT("%d %f %f"), NumPlayers, HistoryLength,
+				ServerSideRewindBenchmark::DenseGridSpacing));
+		}
+
+		/** Spread out players are only run with the short history, the LODs don't depend on its length */
+		OutBeautifiedNames.Add(FString::Printf(TEXT("%d Players 1s History Spread"), NumPlayers));
+		OutTestCommands.Add(FString::Printf(TEXT("%d %f %f"), NumPlayers, 1.0f,
+			ServerSideRewindBenchmark::SpreadGridSpacing));
+	}
+}
+
+bool FServerSideRewindBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace ServerSideRewindBenchmark;
+
+	TArray<FString> Arguments;
+	Parameters.ParseIntoArrayWS(Arguments);
+	if (Arguments.Num() != 3)
+	{
+		AddError(FString::Printf(TEXT("Expected \"<players> <history seconds> <spacing>\", got \"%s\""), *Parameters));
+		return false;
+	}
+
+	const int32 NumPlayers = FMath::Max(FCString::Atoi(*Arguments[0]), 1);
+	const float HistoryLength = FMath::Max(FCString::Atof(*Arguments[1]), DeltaTime);
+	const float GridSpacing = FMath::Max(FCString::Atof(*Arguments[2]), CircleRadius * 2.0f);
+	const int32 GridSize = FMath::CeilToInt(FMath::Sqrt(static_cast<float>(NumPlayers)));
+
+	UClass* CharacterClass = LoadClass<AFirstPersonCharacter>(nullptr, CharacterClassPath);
+	if (CharacterClass == nullptr)
+	{
+		AddError(FString::Printf(TEXT("Character class %s couldn't be loaded"), CharacterClassPath));
+		return false;
+	}
+
+	/** Bare standalone game world (has authority), nothing in it is ticked except what the benchmark drives */
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("ServerSideRewindBenchmark"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	UServerSideRewindSubsystem* Subsystem = World->GetSubsystem<UServerSideRewindSubsystem>();
+	if (Subsystem == nullptr)
+	{
+		AddError(TEXT("Server side rewind subsystem missing"));
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+		return false;
+	}
+	Subsystem->SetMaxRewindTime(HistoryLength);
+
+	/** Recorded frames are stamped with the game state's server time */
+	World->SetGameState(World->SpawnActor<AGameStateBase>());
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	TArray<AFirstPersonCharacter*> Characters;
+	for (int32 Index = 0; Index < NumPlayers; Index++)
+	{
+		const FTransform Transform = GetScriptedTransform(Index, GridSize, GridSpacing, 0.0f);
+		AFirstPersonCharacter* Character = World->SpawnActor<AFirstPersonCharacter>(CharacterClass, Transform,
+			SpawnParameters);
+		if (Character == nullptr) { continue; }
+
+		Characters.Add(Character);
+	}
+
+	/** Without a layout the subsystem falls back to recording the hitbox transforms, which isn't what ships */
+	FServerSideRewindHitBoxLayout Layout;
+	if (Characters.Num() > 0 && !UServerSideRewindComponent::BuildHitBoxLayout(Characters[0], Layout))
+	{
+		AddError(TEXT("Character has no hitbox layout, bone transforms wouldn't be recorded"));
+	}
+
+	/** Characters register with the subsystem in BeginPlay */
+	World->GetWorldSettings()->NotifyBeginPlay();
+
+	/**
+	* Record the history. Every frame the characters move, the subsystem saves a frame and the actual hitboxes are
+	* kept as ground truth for the shots.
+	*/
+	const int32 NumHistoryFrames = FMath::CeilToInt(HistoryLength / DeltaTime);
+	const int32 NumFrames = NumHistoryFrames + FMath::CeilToInt(SteadyStateTime / DeltaTime);
+
+	/** Ground truth is allocated up front so it doesn't show up in the measured memory growth */
+	TArray<FServerSideRewindFrameTime> FrameTimes;
+	FrameTimes.Reserve(NumFrames);
+	TArray<TArray<FServerSideRewindSnapshot>> GroundTruth;
+	GroundTruth.SetNum(NumFrames);
+	for (TArray<FServerSideRewindSnapshot>& Snapshots : GroundTruth) { Snapshots.SetNum(Characters.Num()); }
+	TArray<TArray<EServerSideRewindLOD>> RecordedLODs;
+	RecordedLODs.SetNum(NumFrames);
+	for (TArray<EServerSideRewindLOD>& LODs : RecordedLODs) { LODs.SetNum(Characters.Num()); }
+	int32 NumRecordsPerLOD[static_cast<int32>(EServerSideRewindLOD::Num)] = {};
+
+	FTiming CaptureTiming;
+	FTiming SteadyStateCaptureTiming;
+	double SteadyStateMemoryBefore = 0.0;
+	const double MemoryBefore = GetUsedPhysicalKilobytes();
+
+	for (int32 FrameIndex = 0; FrameIndex < NumFrames; FrameIndex++)
+	{
+		World->TimeSeconds += DeltaTime;
+		World->RealTimeSeconds += DeltaTime;
+		const float Time = World->GetTimeSeconds();
+
+		/** The world isn't ticked, so the animation is advanced by hand to keep the bones moving relative to the root */
+		for (int32 Index = 0; Index < Characters.Num(); Index++)
+		{
+			Characters[Index]->SetActorTransform(GetScriptedTransform(Index, GridSize, GridSpacing, Time), false,
+				nullptr, ETeleportType::TeleportPhysics);
+
+			USkeletalMeshComponent* Mesh = Characters[Index]->GetMesh();
+			Mesh->TickAnimation(DeltaTime, false);
+			Mesh->RefreshBoneTransforms();
+		}
+
+		/** History is full from here on, recording should no longer allocate */
+		if (FrameIndex == NumHistoryFrames) { SteadyStateMemoryBefore = GetUsedPhysicalKilobytes(); }
+
+		const double StartSeconds = FPlatformTime::Seconds();
+		Subsystem->Tick(DeltaTime);
+		const double Seconds = FPlatformTime::Seconds() - StartSeconds;
+		CaptureTiming.Add(Seconds);
+		if (FrameIndex >= NumHistoryFrames) { SteadyStateCaptureTiming.Add(Seconds); }
+
+		/** Shots are reported at the time the subsystem recorded this tick at */
+		const FServerSideRewindFrameTime FrameTime = Subsystem->GetFrameHistory().GetNewest().Time;
+		FrameTimes.Add(FrameTime);
+		for (int32 Index = 0; Index < Characters.Num(); Index++)
+		{
+			UServerSideRewindComponent::TakeServerSideRewindSnapshot(Characters[Index], FrameTime,
+				GroundTruth[FrameIndex][Index]);
+
+			const EServerSideRewindLOD LOD = Subsystem->GetLOD(
+				Characters[Index]->GetServerSideRewindComponent()->GetServerSideRewindSlot());
+			RecordedLODs[FrameIndex][Index] = LOD;
+			NumRecordsPerLOD[static_cast<int32>(LOD)]++;
+		}
+	}
+
+	const double SteadyStateMemoryGrowth = GetUsedPhysicalKilobytes() - SteadyStateMemoryBefore;
+	const double RecordingMemoryGrowth = GetUsedPhysicalKilobytes() - MemoryBefore;
+
+	/** Only frames still in the history can be rewound to */
+	const FServerSideRewindFrameTime OldestTime = Subsystem->GetFrameHistory().GetOldest().Time;
+	int32 FirstShotFrame = 0;
+	while (FirstShotFrame < FrameTimes.Num() - 1 && FrameTimes[FirstShotFrame] < OldestTime) { FirstShotFrame++; }
+
+	/**
+	* Fire shots at recorded frames in batches through the subsystem's shot queue, validated by a tick the same way as
+	* the shots received during a frame, and compare the first character hit with the ground truth.
+	* The clock isn't advanced anymore, so these ticks don't record frames and the history stays as it is.
+	* The shot budget is lifted so every batch is validated in the tick it was queued for.
+	*/
+	IConsoleVariable* ShotBudget = IConsoleManager::Get().FindConsoleVariable(TEXT("ServerSideRewind.ShotBudget"));
+	const float SavedShotBudget = ShotBudget != nullptr ? ShotBudget->GetFloat() : 0.0f;
+	if (ShotBudget != nullptr) { ShotBudget->Set(0.0f, ECVF_SetByCode); }
+
+	TArray<FServerSideRewindShotHit> BatchHits;
+	const FDelegateHandle ShotValidatedHandle = Subsystem->OnShotValidated.AddLambda(
+		[&BatchHits](const FServerSideRewindShot& Shot, TArrayView<const FServerSideRewindShotHit> Hits)
+		{
+			BatchHits[Hits[0].ShotIndex] = Hits[0];
+		});
+
+	FRandomStream RandomStream(NumPlayers * 1000 + FMath::RoundToInt(HistoryLength * 10.0f));
+	FTiming LookupTiming;
+	FTiming BroadphaseTiming;
+	FTiming ValidationTiming;
+	FServerSideRewindSnapshot RewoundSnapshot;
+	TArray<int32> CandidateSlots;
+	TArray<FServerSideRewindShotHit> ExpectedHits;
+	TArray<int32> ShotFrames;
+	int32 NumShotsFired = 0;
+	int32 NumExpectedHits = 0;
+	int32 NumHits = 0;
+	int32 NumMismatches = 0;
+	int32 NumReducedShots = 0;
+	int32 NumReducedMismatches = 0;
+	int32 NumTooOld = 0;
+
+	const double ShotsMemoryBefore = GetUsedPhysicalKilobytes();
+	while (NumShotsFired < NumShots && Characters.Num() > 1)
+	{
+		const int32 NumBatchShots = FMath::Min(ShotsPerBatch, NumShots - NumShotsFired);
+		ExpectedHits.Reset();
+		ExpectedHits.SetNum(NumBatchShots);
+		ShotFrames.SetNum(NumBatchShots);
+		BatchHits.Reset();
+		BatchHits.SetNum(NumBatchShots);
+
+		for (int32 ShotIndex = 0; ShotIndex < NumBatchShots; ShotIndex++)
+		{
+			const int32 FrameIndex = RandomStream.RandRange(FirstShotFrame, FrameTimes.Num() - 1);
+			ShotFrames[ShotIndex] = FrameIndex;
+			const int32 TargetIndex = RandomStream.RandRange(0, Characters.Num() - 1);
+			const int32 ShooterIndex = (TargetIndex + 1) % Characters.Num();
+			AFirstPersonCharacter* Target = Characters[TargetIndex];
+			const FServerSideRewindSnapshot& Truth = GroundTruth[FrameIndex][TargetIndex];
+
+			/** Aim through the center of a random hitbox, or next to the character for the misses */
+			const int32 HitBoxIndex = RandomStream.RandRange(0, FMath::Max(Truth.NumHitBoxes - 1, 0));
+			const FVector Direction = FRotator(RandomStream.FRandRange(-30.0f, 30.0f),
+				RandomStream.FRandRange(0.0f, 360.0f), 0.0f).Vector();
+			FVector AimPoint = Truth.NumHitBoxes > 0 ? Truth.HitBoxLocations[HitBoxIndex] : Target->GetActorLocation();
+			if (RandomStream.FRand() < MissRatio)
+			{
+				AimPoint += FVector(-Direction.Y, Direction.X, 0.0f).GetSafeNormal() * 300.0f;
+			}
+			const FVector Start = AimPoint - Direction * 1000.0f;
+			const FVector End = AimPoint + Direction * 1000.0f;
+			const FServerSideRewindFrameTime Time = FrameTimes[FrameIndex];
+
+			/** Shots can hit any character along their line, the closest one at the hit time is the expected hit */
+			for (int32 Index = 0; Index < Characters.Num(); Index++)
+			{
+				FServerSideRewindHitResult HitResult;
+				if (Index == ShooterIndex ||
+					!ServerSideRewind::LineTraceSnapshot(GroundTruth[FrameIndex][Index], Start, End, HitResult))
+				{
+					continue;
+				}
+
+				FServerSideRewindShotHit& ExpectedHit = ExpectedHits[ShotIndex];
+				if (ExpectedHit.HitCharacter == nullptr || HitResult.Distance < ExpectedHit.HitResult.Distance)
+				{
+					ExpectedHit.HitCharacter = Characters[Index];
+					ExpectedHit.HitResult = HitResult;
+				}
+			}
+			NumExpectedHits += ExpectedHits[ShotIndex].HitCharacter != nullptr ? 1 : 0;
+
+			/** Lookup and broadphase are timed on their own as well, validation runs them again */
+			double StartSeconds = FPlatformTime::Seconds();
+			const bool bFound = Subsystem->FindSnapshotToCheck(
+				Target->GetServerSideRewindComponent()->GetServerSideRewindSlot(), Time, RewoundSnapshot);
+			LookupTiming.Add(FPlatformTime::Seconds() - StartSeconds);
+			if (!bFound) { NumTooOld++; }
+
+			StartSeconds = FPlatformTime::Seconds();
+			Subsystem->FindCandidates(Time, Start, End, CandidateSlots);
+			BroadphaseTiming.Add(FPlatformTime::Seconds() - StartSeconds);
+
+			const int32 ShooterSlot = Characters[ShooterIndex]->GetServerSideRewindComponent()->GetServerSideRewindSlot();
+			Subsystem->QueueShot(ShooterSlot, Time, Start, End);
+		}
+
+		/** One tick validates the whole batch (broadphase, grouping, validation tasks and completion) */
+		const double StartSeconds = FPlatformTime::Seconds();
+		Subsystem->Tick(DeltaTime);
+		ValidationTiming.Add((FPlatformTime::Seconds() - StartSeconds) / NumBatchShots);
+		NumShotsFired += NumBatchShots;
+
+		for (int32 ShotIndex = 0; ShotIndex < NumBatchShots; ShotIndex++)
+		{
+			const FServerSideRewindShotHit& Hit = BatchHits[ShotIndex];
+			const FServerSideRewindShotHit& ExpectedHit = ExpectedHits[ShotIndex];
+			NumHits += Hit.HitCharacter != nullptr ? 1 : 0;
+
+			/** Characters recorded as proxy or with a reused pose can't match the ground truth exactly */
+			const TArray<EServerSideRewindLOD>& LODs = RecordedLODs[ShotFrames[ShotIndex]];
+			const auto IsRecordedInFull = [&](const AFirstPersonCharacter* HitCharacter)
+			{
+				const int32 Index = Characters.IndexOfByKey(HitCharacter);
+				return Index == INDEX_NONE || LODs[Index] == EServerSideRewindLOD::Full;
+			};
+			const bool bReduced = !IsRecordedInFull(Hit.HitCharacter) || !IsRecordedInFull(ExpectedHit.HitCharacter);
+			NumReducedShots += bReduced ? 1 : 0;
+
+			if (Hit.HitCharacter != ExpectedHit.HitCharacter ||
+				(Hit.HitCharacter != nullptr && Hit.HitResult.HitBoxIndex != ExpectedHit.HitResult.HitBoxIndex))
+			{
+				(bReduced ? NumReducedMismatches : NumMismatches)++;
+			}
+		}
+	}
+
+	Subsystem->OnShotValidated.Remove(ShotValidatedHandle);
+	if (ShotBudget != nullptr) { ShotBudget->Set(SavedShotBudget, ECVF_SetByCode); }
+	const double ShotsMemoryGrowth = GetUsedPhysicalKilobytes() - ShotsMemoryBefore;
+
+	SIZE_T PackedBytes = 0;
+	SIZE_T UnpackedBytes = 0;
+	Subsystem->GetHistoryMemoryUsage(PackedBytes, UnpackedBytes);
+
+	const int32 NumRecords = FMath::Max(FrameTimes.Num() * Characters.Num(), 1);
+	AddInfo(FString::Printf(TEXT("%d players %.0f cm apart, %.1f s history, %d frames recorded, %d shots"),
+		Characters.Num(), GridSpacing, HistoryLength, FrameTimes.Num(), NumShotsFired));
+	AddInfo(FString::Printf(TEXT("LOD: %.1f%% full, %.1f%% reduced, %.1f%% proxy records"),
+		NumRecordsPerLOD[static_cast<int32>(EServerSideRewindLOD::Full)] * 100.0 / NumRecords,
+		NumRecordsPerLOD[static_cast<int32>(EServerSideRewindLOD::Reduced)] * 100.0 / NumRecords,
+		NumRecordsPerLOD[static_cast<int32>(EServerSideRewindLOD::Proxy)] * 100.0 / NumRecords));
+	AddInfo(FString::Printf(TEXT("Capture: %.1f us avg, %.1f us max (steady state %.1f us avg)"),
+		CaptureTiming.GetAverageMicroseconds(), CaptureTiming.GetMaxMicroseconds(),
+		SteadyStateCaptureTiming.GetAverageMicroseconds()));
+	AddInfo(FString::Printf(TEXT("Lookup: %.2f us avg, %.2f us max"),
+		LookupTiming.GetAverageMicroseconds(), LookupTiming.GetMaxMicroseconds()));
+	AddInfo(FString::Printf(TEXT("Broadphase: %.2f us avg, %.2f us max"),
+		BroadphaseTiming.GetAverageMicroseconds(), BroadphaseTiming.GetMaxMicroseconds()));
+	AddInfo(FString::Printf(TEXT("Validation: %.2f us per shot avg, %.2f us per shot in the slowest batch of %d"),
+		ValidationTiming.GetAverageMicroseconds(), ValidationTiming.GetMaxMicroseconds(), ShotsPerBatch));
+	AddInfo(FString::Printf(TEXT("History: %.1f KB (%.1f KB as full snapshots), %.1f bytes per player and frame"),
+		PackedBytes / 1024.0, UnpackedBytes / 1024.0,
+		static_cast<double>(PackedBytes) / FMath::Max(Characters.Num() * Subsystem->GetFrameHistory().Num(), 1)));
+	AddInfo(FString::Printf(TEXT("Memory growth: %.1f KB recording, %.1f KB steady state, %.1f KB shots"),
+		RecordingMemoryGrowth, SteadyStateMemoryGrowth, ShotsMemoryGrowth));
+	AddInfo(FString::Printf(TEXT("Correctness: %d hits (%d expected), %d mismatches, %d outside of the history"),
+		NumHits, NumExpectedHits, NumMismatches + NumReducedMismatches, NumTooOld));
+	AddInfo(FString::Printf(TEXT("Reduced fidelity: %d shots involving a reduced or proxy record, %d of them mismatched"),
+		NumReducedShots, NumReducedMismatches));
+
+	if (NumTooOld > 0)
+	{
+		AddError(FString::Printf(TEXT("%d shots within the max rewind time weren't found in the history"), NumTooOld));
+	}
+	const int32 NumFullShots = NumShotsFired - NumReducedShots;
+	if (NumMismatches > NumFullShots * MaxMismatchRatio)
+	{
+		AddError(FString::Printf(TEXT("%d of %d shots at fully recorded characters disagree with the ground truth"),
+			NumMismatches, NumFullShots));
+	}
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	return true;
+}
+
+#endif
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+/**
+* Minimal micro-benchmark harness in the style of Google Benchmark, so the core builds without external dependencies.
+* Every benchmark runs its loop with a growing iteration count until it ran for at least the min time,
+* then reports wall and CPU time per iteration.
+*/
+namespace MicroBenchmark
+{
+	/** Keeps the compiler from optimizing away a value only computed for the benchmark */
+	template<typename ValueType>
+	inline void DoNotOptimize(const ValueType& Value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(Value) : "memory");
+#else
+		const volatile char* Pointer = reinterpret_cast<const volatile char*>(&Value);
+		(void)*Pointer;
+#endif
+	}
+
+	class FState
+	{
+	public:
+		explicit FState(int64_t InIterations) : Iterations(InIterations) {}
+
+		/** Returns true while iterations are left, usage: while (State.KeepRunning()) { ... } */
+		bool KeepRunning() { return Remaining-- > 0; }
+
+		int64_t GetIterations() const { return Iterations; }
+
+		/** Amount of items (e.g. shots) processed per iteration, reported as items per second */
+		void SetItemsPerIteration(int64_t InItems) { ItemsPerIteration = InItems; }
+		int64_t GetItemsPerIteration() const { return ItemsPerIteration; }
+
+	private:
+		int64_t Iterations;
+		int64_t Remaining = Iterations;
+		int64_t ItemsPerIteration = 0;
+	};
+
+	struct FBenchmark
+	{
+		std::string Name;
+		std::function<void(FState&)> Function;
+	};
+
+	class FRunner
+	{
+	public:
+		void Add(const std::string& Name, std::function<void(FState&)> Function)
+		{
+			Benchmarks.push_back({ Name, std::move(Function) });
+		}
+
+		/**
+		* Runs all benchmarks whose name contains Filter.
+		* A min time of 0 runs every benchmark exactly once (smoke test).
+		*/
+		void Run(const std::string& Filter, double MinTime) const
+		{
+			std::printf("%-48s %14s %14s %12s %14s\n", "Benchmark", "Time", "CPU", "Iterations", "Items/s");
+			std::printf("%s\n", std::string(106, '-').c_str());
+
+			for (const FBenchmark& Benchmark : Benchmarks)
+			{
+				if (!Filter.empty() && Benchmark.Name.find(Filter) == std::string::npos) { continue; }
+
+				int64_t Iterations = 1;
+				double WallSeconds = 0.0;
+				double CpuSeconds = 0.0;
+				int64_t ItemsPerIteration = 0;
+				for (;;)
+				{
+					FState State(Iterations);
+					const std::clock_t CpuStart = std::clock();
+					const auto WallStart = std::chrono::steady_clock::now();
+					Benchmark.Function(State);
+					WallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - WallStart).count();
+					CpuSeconds = static_cast<double>(std::clock() - CpuStart) / CLOCKS_PER_SEC;
+					ItemsPerIteration = State.GetItemsPerIteration();
+
+					if (WallSeconds >= MinTime || Iterations >= (int64_t(1) << 40)) { break; }
+
+					/** Aim a bit past the min time based on the last run, growing at most tenfold per run */
+					const double Scale = WallSeconds > 0.0 ? MinTime * 1.4 / WallSeconds : 10.0;
+					Iterations = static_cast<int64_t>(Iterations * (Scale < 10.0 ? (Scale > 1.0 ? Scale : 2.0) : 10.0));
+				}
+
+				const double ItemsPerSecond = WallSeconds > 0.0 ?
+					static_cast<double>(ItemsPerIteration) * Iterations / WallSeconds : 0.0;
+				std::printf("%-48s %11.1f ns %11.1f ns %12lld %14.0f\n", Benchmark.Name.c_str(),
+					WallSeconds * 1.0e9 / Iterations, CpuSeconds * 1.0e9 / Iterations,
+					static_cast<long long>(Iterations), ItemsPerSecond);
+			}
+		}
+
+	private:
+		std::vector<FBenchmark> Benchmarks;
+	};
+}
@@ -0,0 +1,468 @@
+#include "MicroBenchmark.h"
+#include "ServerSideRewindCore/HitTest.h"
+#include "ServerSideRewindCore/RingBuffer.h"
+#include "ServerSideRewindCore/Snapshot.h"
+#include "ServerSideRewindCore/TimeLookup.h"
+#include <cmath>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ServerSideRewindCore;
+
+
+namespace
+{
+	/** Frame rate the synthetic history is recorded at, one frame per frame number */
+	constexpr float FrameRate = 60.0f;
+
+	constexpr float MaxRewindTime = 3.0f;
+
+	/** Frame of the synthetic history, one snapshot per player relative to the player's root */
+	struct FFrame
+	{
+		FFrameTime Time;
+		std::vector<FHitBoxSnapshot> Snapshots;
+	};
+
+	struct FShot
+	{
+		int32_t Player = 0;
+		FFrameTime Time;
+		FVec3 Start;
+		FVec3 Direction;
+		float Length = 0.0f;
+	};
+
+	FVec3 RandomVector(std::mt19937& Random, float Range)
+	{
+		std::uniform_real_distribution<float> Distribution(-Range, Range);
+		return FVec3(Distribution(Random), Distribution(Random), Distribution(Random));
+	}
+
+	FVec3 Normalize(const FVec3& Vector)
+	{
+		const float Size = Vector.Size();
+		return Size > 0.0f ? Vector * (1.0f / Size) : FVec3(1.0f, 0.0f, 0.0f);
+	}
+
+	FQuat4 RandomRotation(std::mt19937& Random)
+	{
+		std::normal_distribution<float> Distribution;
+		FQuat4 Rotation(Distribution(Random), Distribution(Random), Distribution(Random), Distribution(Random));
+		const float InverseSize = 1.0f / std::sqrt(Rotation.X * Rotation.X + Rotation.Y * Rotation.Y +
+			Rotation.Z * Rotation.Z + Rotation.W * Rotation.W);
+		return FQuat4(Rotation.X * InverseSize, Rotation.Y * InverseSize, Rotation.Z * InverseSize,
+			Rotation.W * InverseSize);
+	}
+
+	/** Character sized set of hitboxes around the root */
+	FHitBoxSnapshot RandomSnapshot(std::mt19937& Random, FFrameTime Time)
+	{
+		std::uniform_real_distribution<float> ExtentDistribution(5.0f, 15.0f);
+
+		FHitBoxSnapshot Snapshot;
+		Snapshot.Time = Time;
+		Snapshot.NumHitBoxes = 15;
+		for (int32_t Index = 0; Index < Snapshot.NumHitBoxes; Index++)
+		{
+			Snapshot.Locations[Index] = RandomVector(Random, 50.0f) + FVec3(0.0f, 0.0f, 90.0f);
+			Snapshot.Rotations[Index] = RandomRotation(Random);
+			Snapshot.Extents[Index] = FVec3(ExtentDistribution(Random), ExtentDistribution(Random),
+				ExtentDistribution(Random));
+		}
+		return Snapshot;
+	}
+
+	/** Shot from a few meters away aimed close to one of the hitboxes, so both hits and misses are tested */
+	FShot RandomShot(std::mt19937& Random, const FHitBoxSnapshot& Snapshot)
+	{
+		std::uniform_int_distribution<int32_t> HitBoxDistribution(0, Snapshot.NumHitBoxes - 1);
+		const FVec3 Target = Snapshot.Locations[HitBoxDistribution(Random)] + RandomVector(Random, 20.0f);
+
+		FShot Shot;
+		Shot.Start = Target + Normalize(RandomVector(Random, 1.0f)) * 500.0f;
+		Shot.Direction = Normalize(Target - Shot.Start);
+		Shot.Length = 1000.0f;
+		return Shot;
+	}
+
+	void FillHistory(TRingBuffer<FFrame>& History, int32_t NumPlayers, std::mt19937& Random)
+	{
+		const int32_t NumFrames = static_cast<int32_t>(std::ceil(MaxRewindTime * FrameRate)) + 1;
+		History.Init(NumFrames);
+		for (int32_t FrameIndex = 0; FrameIndex < NumFrames; FrameIndex++)
+		{
+			FFrame& Frame = History.Push();
+			Frame.Time = FFrameTime(FrameIndex);
+			Frame.Snapshots.clear();
+			for (int32_t Player = 0; Player < NumPlayers; Player++)
+			{
+				Frame.Snapshots.push_back(RandomSnapshot(Random, Frame.Time));
+			}
+		}
+	}
+
+	/** Full rewind of one shot: time lookup, interpolation, batch conversion and hit test */
+	bool CheckShot(const TRingBuffer<FFrame>& History, const FShot& Shot, FRayHit& OutHit)
+	{
+		FFrameLookup Lookup;
+		const bool bFound = FindFramesToCheck(History.Num(),
+			[&History](int32_t Index) { return History[Index].Time; }, Shot.Time, Lookup);
+		if (!bFound) { return false; }
+
+		FHitBoxSnapshot Snapshot;
+		InterpolateSnapshots(History[Lookup.OlderIndex].Snapshots[Shot.Player],
+			History[Lookup.NewerIndex].Snapshots[Shot.Player], Lookup.Alpha, Snapshot);
+
+		FHitBoxBatch Batch;
+		Batch.Build(Snapshot);
+		return LineTraceBatch(Batch, Shot.Start, Shot.Direction, Shot.Length, OutHit);
+	}
+
+	/** Reports a failed check of the smoke test */
+	bool Expect(bool bCondition, const char* Description, int& InOutFailures)
+	{
+		if (!bCondition)
+		{
+			std::printf("FAILED: %s\n", Description);
+			InOutFailures++;
+		}
+		return bCondition;
+	}
+
+	/**
+	* Checks the core against simple reference implementations.
+	* Run as part of ctest, so SIMD and layout variants can be verified before comparing their timings.
+	*/
+	int RunChecks()
+	{
+		int Failures = 0;
+		std::mt19937 Random(1234);
+
+		/** Ring buffer against a deque */
+		{
+			TRingBuffer<int32_t> Ring;
+			Ring.Init(7);
+			std::deque<int32_t> Reference;
+			for (int32_t Value = 0; Value < 100; Value++)
+			{
+				if (Value % 5 == 4 && !Reference.empty())
+				{
+					Ring.PopOldest();
+					Reference.pop_front();
+					continue;
+				}
+
+				Ring.Push() = Value;
+				Reference.push_back(Value);
+				if (static_cast<int32_t>(Reference.size()) > Ring.Capacity()) { Reference.pop_front(); }
+			}
+
+			bool bEqual = Ring.Num() == static_cast<int32_t>(Reference.size());
+			for (int32_t Index = 0; bEqual && Index < Ring.Num(); Index++) { bEqual = Ring[Index] == Reference[Index]; }
+			Expect(bEqual, "ring buffer matches reference", Failures);
+		}
+
+		/** Frame time conversions keep their precision far into a session */
+		{
+			const double Seconds = 6.0 * 3600.0 + 1.0 / 120.0;
+			const FFrameTime Time = FFrameTime::FromSeconds(Seconds, FrameRate);
+			const FFrameTime Earlier = Time.AddFrames(-2.25f);
+			Expect(Time.Frame == 6 * 3600 * 60 && std::fabs(Time.Alpha - 0.5f) < 1.e-3f &&
+				std::fabs(Time.ToSeconds(FrameRate) - Seconds) < 1.e-6 &&
+				Earlier.Frame == Time.Frame - 2 && Earlier < Time && std::fabs(Time.FramesSince(Earlier) - 2.25f) < 1.e-6f,
+				"frame time conversions", Failures);
+		}
+
+		/**
+		* Time lookup against a linear scan, with frames captured at varying offsets past their frame number
+		* (server ticks don't line up with the frame grid) and frame numbers skipped (reduced record rate, hitches)
+		*/
+		{
+			std::uniform_real_distribution<float> AlphaDistribution(0.0f, 1.0f);
+			std::vector<FFrameTime> FrameTimes;
+			int32_t FrameNumber = 1000;
+			for (int32_t Index = 0; Index < 50; Index++)
+			{
+				FrameTimes.push_back(FFrameTime(FrameNumber, Index % 5 == 0 ? 0.0f : AlphaDistribution(Random)));
+				FrameNumber += Index % 7 == 3 ? 3 : (Index % 11 == 5 ? 2 : 1);
+			}
+			const auto GetFrameTime = [&FrameTimes](int32_t Index) { return FrameTimes[Index]; };
+
+			std::uniform_int_distribution<int32_t> FrameDistribution(FrameTimes.front().Frame - 5,
+				FrameTimes.back().Frame + 5);
+			for (int32_t Test = 0; Test < 1000; Test++)
+			{
+				const FFrameTime Time(FrameDistribution(Random), Test % 4 == 0 ? 0.0f : AlphaDistribution(Random));
+				FFrameLookup Lookup;
+				const bool bFound = FindFramesToCheck(static_cast<int32_t>(FrameTimes.size()), GetFrameTime, Time,
+					Lookup);
+
+				int32_t Expected = -1;
+				for (int32_t Index = 0; Index < static_cast<int32_t>(FrameTimes.size()); Index++)
+				{
+					if (!(Time < FrameTimes[Index])) { Expected = Index; }
+				}
+
+				/** Interpolated time must be the hit time, except past the newest frame */
+				bool bCorrect = bFound == (Expected != -1) && (!bFound || Lookup.OlderIndex == Expected);
+				if (bCorrect && bFound && Lookup.OlderIndex != Lookup.NewerIndex)
+				{
+					const FFrameTime Interpolated = FFrameTime::Lerp(FrameTimes[Lookup.OlderIndex],
+						FrameTimes[Lookup.NewerIndex], Lookup.Alpha);
+					bCorrect = std::fabs(Interpolated.FramesSince(Time)) < 1.e-4f;
+				}
+				if (!Expect(bCorrect, "time lookup matches linear scan", Failures)) { break; }
+			}
+		}
+
+		/** Interpolation ends at the snapshots it interpolates between */
+		{
+			const FHitBoxSnapshot Older = RandomSnapshot(Random, FFrameTime(0));
+			const FHitBoxSnapshot Newer = RandomSnapshot(Random, FFrameTime(1));
+			FHitBoxSnapshot Start;
+			FHitBoxSnapshot End;
+			InterpolateSnapshots(Older, Newer, 0.0f, Start);
+			InterpolateSnapshots(Older, Newer, 1.0f, End);
+
+			float MaxError = 0.0f;
+			for (int32_t Index = 0; Index < Older.NumHitBoxes; Index++)
+			{
+				MaxError = std::fmax(MaxError, (Start.Locations[Index] - Older.Locations[Index]).Size());
+				MaxError = std::fmax(MaxError, (End.Locations[Index] - Newer.Locations[Index]).Size());
+				const FVec3 Axis = FVec3(1.0f, 0.0f, 0.0f);
+				MaxError = std::fmax(MaxError, (Start.Rotations[Index].RotateVector(Axis) -
+					Older.Rotations[Index].RotateVector(Axis)).Size());
+				MaxError = std::fmax(MaxError, (End.Rotations[Index].RotateVector(Axis) -
+					Newer.Rotations[Index].RotateVector(Axis)).Size());
+			}
+			Expect(MaxError < 1.e-3f, "interpolation ends at the snapshots", Failures);
+		}
+
+		/** Batched hit test, scalar batch and per box test agree (own generator, so other checks don't change its shots) */
+		{
+			std::mt19937 HitTestRandom(5678);
+			int32_t NumHits = 0;
+			for (int32_t Test = 0; Test < 10000; Test++)
+			{
+				const FHitBoxSnapshot Snapshot = RandomSnapshot(HitTestRandom, FFrameTime(0));
+				const FShot Shot = RandomShot(HitTestRandom, Snapshot);
+
+				FHitBoxBatch Batch;
+				Batch.Build(Snapshot);
+				FRayHit BatchHit;
+				FRayHit ScalarHit;
+				LineTraceBatch(Batch, Shot.Start, Shot.Direction, Shot.Length, BatchHit);
+				LineTraceBatchScalar(Batch, Shot.Start, Shot.Direction, Shot.Length, ScalarHit);
+
+				FRayHit ReferenceHit;
+				for (int32_t Index = 0; Index < Snapshot.NumHitBoxes; Index++)
+				{
+					float Distance;
+					if (IntersectRayBox(Shot.Start, Shot.Direction, Shot.Length, Snapshot.Locations[Index],
+						Snapshot.Rotations[Index], Snapshot.Extents[Index], Distance) &&
+						(!ReferenceHit.bHit || Distance < ReferenceHit.Distance))
+					{
+						ReferenceHit.bHit = true;
+						ReferenceHit.HitBoxIndex = Index;
+						ReferenceHit.Distance = Distance;
+					}
+				}
+				NumHits += ReferenceHit.bHit ? 1 : 0;
+
+				/** Boxes can be entered at practically the same distance, only then may the index differ */
+				const auto Matches = [&ReferenceHit](const FRayHit& Hit)
+				{
+					if (Hit.bHit != ReferenceHit.bHit) { return false; }
+					if (!Hit.bHit) { return true; }
+					return std::fabs(Hit.Distance - ReferenceHit.Distance) < 1.e-2f;
+				};
+				if (!Expect(Matches(BatchHit) && Matches(ScalarHit), "batched hit test matches per box test", Failures))
+				{
+					break;
+				}
+			}
+			Expect(NumHits > 1000 && NumHits < 9000, "hit test checks both hits and misses", Failures);
+		}
+
+		std::printf("%s (SIMD %s)\n\n", Failures == 0 ? "All checks passed" : "Checks failed",
+			SERVERSIDEREWINDCORE_SIMD ? "on" : "off");
+		return Failures;
+	}
+}
+
+
+int main(int ArgumentCount, char** Arguments)
+{
+	std::string Filter;
+	double MinTime = 0.5;
+	bool bSmoke = false;
+	for (int Index = 1; Index < ArgumentCount; Index++)
+	{
+		const std::string Argument = Arguments[Index];
+		if (Argument == "--smoke") { bSmoke = true; }
+		else if (Argument.rfind("--filter=", 0) == 0) { Filter = Argument.substr(9); }
+		else if (Argument.rfind("--min-time=", 0) == 0) { MinTime = std::atof(Argument.c_str() + 11); }
+		else
+		{
+			std::printf("Usage: %s [--smoke] [--filter=<substring>] [--min-time=<seconds>]\n", Arguments[0]);
+			return 1;
+		}
+	}
+
+	/** Smoke runs only verify the core and run every benchmark once */
+	if (RunChecks() != 0) { return 1; }
+	if (bSmoke) { MinTime = 0.0; }
+
+	MicroBenchmark::FRunner Runner;
+	std::mt19937 Random(42);
+
+	Runner.Add("RingBuffer/Push", [](MicroBenchmark::FState& State)
+	{
+		TRingBuffer<FFrame> History;
+		History.Init(static_cast<int32_t>(std::ceil(MaxRewindTime * FrameRate)) + 1);
+		int32_t FrameNumber = 0;
+		while (State.KeepRunning())
+		{
+			FFrame& Frame = History.Push();
+			Frame.Time = FFrameTime(FrameNumber++);
+			MicroBenchmark::DoNotOptimize(Frame);
+		}
+	});
+
+	/** Direct index into a history with every frame number, binary search into one recorded every other frame */
+	for (const int32_t FrameStep : { 1, 2 })
+	{
+		for (const int32_t NumFrames : { 64, 256, 1024 })
+		{
+			std::vector<FFrameTime> FrameTimes(static_cast<size_t>(NumFrames));
+			for (int32_t Index = 0; Index < NumFrames; Index++)
+			{
+				FrameTimes[Index] = FFrameTime(5000 + Index * FrameStep, (Index % 3) * 0.25f);
+			}
+
+			Runner.Add(std::string(FrameStep == 1 ? "TimeLookup/" : "TimeLookupGaps/") + std::to_string(NumFrames),
+				[FrameTimes, NumFrames](MicroBenchmark::FState& State)
+			{
+				const auto GetFrameTime = [&FrameTimes](int32_t Index) { return FrameTimes[Index]; };
+				const FFrameTime Oldest = FrameTimes.front();
+				const float Span = FrameTimes.back().FramesSince(Oldest);
+				const float Step = Span / 97.0f;
+				float Offset = 0.0f;
+				while (State.KeepRunning())
+				{
+					FFrameLookup Lookup;
+					MicroBenchmark::DoNotOptimize(FindFramesToCheck(NumFrames, GetFrameTime, Oldest.AddFrames(Offset),
+						Lookup));
+					MicroBenchmark::DoNotOptimize(Lookup);
+					Offset = Offset + Step > Span ? 0.0f : Offset + Step;
+				}
+			});
+		}
+	}
+
+	const FHitBoxSnapshot Older = RandomSnapshot(Random, FFrameTime(0));
+	const FHitBoxSnapshot Newer = RandomSnapshot(Random, FFrameTime(1));
+	Runner.Add("InterpolateSnapshots", [Older, Newer](MicroBenchmark::FState& State)
+	{
+		FHitBoxSnapshot Snapshot;
+		while (State.KeepRunning())
+		{
+			InterpolateSnapshots(Older, Newer, 0.37f, Snapshot);
+			MicroBenchmark::DoNotOptimize(Snapshot);
+		}
+	});
+
+	Runner.Add("HitBoxBatch/Build", [Older](MicroBenchmark::FState& State)
+	{
+		FHitBoxBatch Batch;
+		while (State.KeepRunning())
+		{
+			Batch.Build(Older);
+			MicroBenchmark::DoNotOptimize(Batch);
+		}
+	});
+
+	/** Same shots against the same boxes for every hit test variant */
+	std::vector<FShot> Shots;
+	for (int32_t Index = 0; Index < 256; Index++) { Shots.push_back(RandomShot(Random, Older)); }
+	FHitBoxBatch Batch;
+	Batch.Build(Older);
+
+	Runner.Add("LineTrace/IntersectRayBox", [Older, Shots](MicroBenchmark::FState& State)
+	{
+		size_t ShotIndex = 0;
+		while (State.KeepRunning())
+		{
+			const FShot& Shot = Shots[ShotIndex++ & 255];
+			for (int32_t Index = 0; Index < Older.NumHitBoxes; Index++)
+			{
+				float Distance;
+				MicroBenchmark::DoNotOptimize(IntersectRayBox(Shot.Start, Shot.Direction, Shot.Length,
+					Older.Locations[Index], Older.Rotations[Index], Older.Extents[Index], Distance));
+			}
+		}
+	});
+
+	Runner.Add("LineTrace/BatchScalar", [Batch, Shots](MicroBenchmark::FState& State)
+	{
+		size_t ShotIndex = 0;
+		FRayHit Hit;
+		while (State.KeepRunning())
+		{
+			const FShot& Shot = Shots[ShotIndex++ & 255];
+			MicroBenchmark::DoNotOptimize(LineTraceBatchScalar(Batch, Shot.Start, Shot.Direction, Shot.Length, Hit));
+		}
+	});
+
+	Runner.Add("LineTrace/Batch", [Batch, Shots](MicroBenchmark::FState& State)
+	{
+		size_t ShotIndex = 0;
+		FRayHit Hit;
+		while (State.KeepRunning())
+		{
+			const FShot& Shot = Shots[ShotIndex++ & 255];
+			MicroBenchmark::DoNotOptimize(LineTraceBatch(Batch, Shot.Start, Shot.Direction, Shot.Length, Hit));
+		}
+	});
+
+	/** Whole rewind of one shot against histories of different sizes (cache behavior of the frame layout) */
+	for (const int32_t NumPlayers : { 8, 32, 100 })
+	{
+		std::mt19937 HistoryRandom(NumPlayers);
+		const auto History = std::make_shared<TRingBuffer<FFrame>>();
+		FillHistory(*History, NumPlayers, HistoryRandom);
+
+		std::vector<FShot> PlayerShots;
+		std::uniform_int_distribution<int32_t> PlayerDistribution(0, NumPlayers - 1);
+		const FFrameTime Oldest = History->GetOldest().Time;
+		std::uniform_real_distribution<float> FramesDistribution(0.0f, History->GetNewest().Time.FramesSince(Oldest));
+		for (int32_t Index = 0; Index < 1024; Index++)
+		{
+			const int32_t Player = PlayerDistribution(HistoryRandom);
+			FShot Shot = RandomShot(HistoryRandom, History->GetNewest().Snapshots[Player]);
+			Shot.Player = Player;
+			Shot.Time = Oldest.AddFrames(FramesDistribution(HistoryRandom));
+			PlayerShots.push_back(Shot);
+		}
+
+		Runner.Add("CheckShot/" + std::to_string(NumPlayers) + "Players",
+			[History, PlayerShots](MicroBenchmark::FState& State)
+		{
+			State.SetItemsPerIteration(1);
+			size_t ShotIndex = 0;
+			FRayHit Hit;
+			while (State.KeepRunning())
+			{
+				MicroBenchmark::DoNotOptimize(CheckShot(*History, PlayerShots[ShotIndex++ & 1023], Hit));
+			}
+		});
+	}
+
+	Runner.Run(Filter, MinTime);
+	return 0;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+
+namespace ServerSideRewindCore
+{
+	/**
+	* Point in time as a server frame number plus how far it is towards the next frame.
+	* Frames are numbered at a fixed rate from the start of the server, so the integer part keeps its precision
+	* however long the server has been running and only the fraction is a float.
+	*/
+	struct FFrameTime
+	{
+		int32_t Frame = 0;
+
+		/** 0 at Frame, towards 1 at the next frame */
+		float Alpha = 0.0f;
+
+		FFrameTime() = default;
+		explicit FFrameTime(int32_t InFrame, float InAlpha = 0.0f) : Frame(InFrame), Alpha(InAlpha) {}
+
+		/** Converts seconds since the start of the server, only precise while Seconds is a double */
+		static FFrameTime FromSeconds(double Seconds, float FrameRate)
+		{
+			const double Frames = Seconds * FrameRate;
+			const double WholeFrames = std::floor(Frames);
+			return FFrameTime(static_cast<int32_t>(WholeFrames), static_cast<float>(Frames - WholeFrames));
+		}
+
+		double ToSeconds(float FrameRate) const
+		{
+			return (static_cast<double>(Frame) + Alpha) / FrameRate;
+		}
+
+		/** Frames from Other to this, precise for close times no matter how large the frame numbers are */
+		float FramesSince(const FFrameTime& Other) const
+		{
+			return static_cast<float>(Frame - Other.Frame) + (Alpha - Other.Alpha);
+		}
+
+		/** Moves the time by a (possibly negative) amount of frames */
+		FFrameTime AddFrames(float Frames) const
+		{
+			const float Total = Alpha + Frames;
+			const float WholeFrames = std::floor(Total);
+			return FFrameTime(Frame + static_cast<int32_t>(WholeFrames), Total - WholeFrames);
+		}
+
+		/** Closest whole frame */
+		int32_t Round() const { return Alpha < 0.5f ? Frame : Frame + 1; }
+
+		bool operator==(const FFrameTime& Other) const { return Frame == Other.Frame && Alpha == Other.Alpha; }
+		bool operator!=(const FFrameTime& Other) const { return !(*this == Other); }
+		bool operator<(const FFrameTime& Other) const
+		{
+			return Frame != Other.Frame ? Frame < Other.Frame : Alpha < Other.Alpha;
+		}
+
+		/** Time Alpha of the way from A to B */
+		static FFrameTime Lerp(const FFrameTime& A, const FFrameTime& B, float Alpha)
+		{
+			return A.AddFrames(B.FramesSince(A) * Alpha);
+		}
+	};
+}
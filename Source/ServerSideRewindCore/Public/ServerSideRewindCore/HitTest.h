@@ -0,0 +1,329 @@
+#pragma once
+
+#include "ServerSideRewindCore/Snapshot.h"
+
+/** Batched hit test using vector registers (SSE2 or NEON), define as 0 to compare against the scalar version */
+#ifndef SERVERSIDEREWINDCORE_SIMD
+	#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || defined(__aarch64__) || defined(_M_ARM64)
+		#define SERVERSIDEREWINDCORE_SIMD 1
+	#else
+		#define SERVERSIDEREWINDCORE_SIMD 0
+	#endif
+#endif
+
+#if SERVERSIDEREWINDCORE_SIMD
+	#if defined(__aarch64__) || defined(_M_ARM64)
+		#include <arm_neon.h>
+	#else
+		#include <emmintrin.h>
+	#endif
+#endif
+
+
+namespace ServerSideRewindCore
+{
+	/** Distance returned for missed boxes */
+	constexpr float BigNumber = 3.4e+38f;
+
+	/** Slopes below this are treated as parallel to a slab */
+	constexpr float SmallNumber = 1.e-8f;
+
+	/** Closest hit of a ray against a set of boxes */
+	struct FRayHit
+	{
+		bool bHit = false;
+
+		/** Index of the hit box, -1 for proxies */
+		int32_t HitBoxIndex = -1;
+
+		/** Distance from the start of the ray to the impact point */
+		float Distance = 0.0f;
+	};
+
+	/**
+	* Intersects ray with an oriented box using the slab method in box-local space.
+	* Direction has to be normalized, OutDistance is 0 if the ray starts inside the box.
+	*/
+	inline bool IntersectRayBox(const FVec3& Start, const FVec3& Direction, float MaxDistance,
+		const FVec3& Center, const FQuat4& Rotation, const FVec3& Extent, float& OutDistance)
+	{
+		/** Transform ray into box-local space, where the box is axis aligned and centered at the origin */
+		const FVec3 LocalStart = Rotation.UnrotateVector(Start - Center);
+		const FVec3 LocalDirection = Rotation.UnrotateVector(Direction);
+
+		float EntryDistance = 0.0f;
+		float ExitDistance = MaxDistance;
+
+		for (int Axis = 0; Axis < 3; Axis++)
+		{
+			const float Origin = LocalStart[Axis];
+			const float Slope = LocalDirection[Axis];
+			const float HalfSize = Extent[Axis];
+
+			/** Ray parallel to the slab, misses if it starts outside of it */
+			if (std::fabs(Slope) < SmallNumber)
+			{
+				if (std::fabs(Origin) > HalfSize) { return false; }
+				continue;
+			}
+
+			const float InverseSlope = 1.0f / Slope;
+			const float Near = (-HalfSize - Origin) * InverseSlope;
+			const float Far = (HalfSize - Origin) * InverseSlope;
+
+			EntryDistance = std::fmax(EntryDistance, std::fmin(Near, Far));
+			ExitDistance = std::fmin(ExitDistance, std::fmax(Near, Far));
+			if (EntryDistance > ExitDistance) { return false; }
+		}
+
+		OutDistance = EntryDistance;
+		return true;
+	}
+
+	/**
+	* Hitboxes of a snapshot in structure-of-arrays form used by the batched hit test.
+	* Every box is stored as its center, its three local axes and its extent,
+	* so one vector register holds the same component of four boxes.
+	*/
+	struct FHitBoxBatch
+	{
+		int32_t NumHitBoxes = 0;
+
+		/** Single box approximating the whole character, hits on it have no hitbox index */
+		bool bProxy = false;
+
+		/** Every array holds a multiple of four floats, so aligning the first one aligns all of them */
+		alignas(16) float CenterX[MaxHitBoxes];
+		float CenterY[MaxHitBoxes];
+		float CenterZ[MaxHitBoxes];
+
+		/** Local axes of the boxes (Axis[Local axis][World component]) */
+		float Axis[3][3][MaxHitBoxes];
+
+		float Extent[3][MaxHitBoxes];
+
+		void SetHitBox(int32_t Index, const FVec3& Center, const FQuat4& Rotation, const FVec3& HalfSize)
+		{
+			CenterX[Index] = Center.X;
+			CenterY[Index] = Center.Y;
+			CenterZ[Index] = Center.Z;
+
+			const FVec3 LocalAxes[3] = { Rotation.GetAxisX(), Rotation.GetAxisY(), Rotation.GetAxisZ() };
+			for (int LocalAxis = 0; LocalAxis < 3; LocalAxis++)
+			{
+				for (int Component = 0; Component < 3; Component++)
+				{
+					Axis[LocalAxis][Component][Index] = LocalAxes[LocalAxis][Component];
+				}
+				Extent[LocalAxis][Index] = HalfSize[LocalAxis];
+			}
+		}
+
+		/** Unused lanes are still tested by the last group of four, but their results are ignored */
+		void ClearHitBox(int32_t Index)
+		{
+			CenterX[Index] = CenterY[Index] = CenterZ[Index] = 0.0f;
+			for (int LocalAxis = 0; LocalAxis < 3; LocalAxis++)
+			{
+				for (int Component = 0; Component < 3; Component++)
+				{
+					Axis[LocalAxis][Component][Index] = LocalAxis == Component ? 1.0f : 0.0f;
+				}
+				Extent[LocalAxis][Index] = 0.0f;
+			}
+		}
+
+		/** Converts snapshot hitboxes into batch form, the batch uses the same origin as the snapshot */
+		void Build(const FHitBoxSnapshot& Snapshot)
+		{
+			NumHitBoxes = Snapshot.NumHitBoxes < MaxHitBoxes ? Snapshot.NumHitBoxes : MaxHitBoxes;
+			bProxy = Snapshot.bProxy;
+			for (int32_t Index = 0; Index < MaxHitBoxes; Index++)
+			{
+				if (Index < NumHitBoxes)
+				{
+					SetHitBox(Index, Snapshot.Locations[Index], Snapshot.Rotations[Index], Snapshot.Extents[Index]);
+				}
+				else { ClearHitBox(Index); }
+			}
+		}
+	};
+
+	/** Picks the closest hit of the per box distances (BigNumber for misses) */
+	inline bool FindClosestHit(const FHitBoxBatch& Batch, const float* Distances, FRayHit& OutHit)
+	{
+		OutHit = FRayHit();
+		for (int32_t Index = 0; Index < Batch.NumHitBoxes; Index++)
+		{
+			if (Distances[Index] < BigNumber && (!OutHit.bHit || Distances[Index] < OutHit.Distance))
+			{
+				OutHit.bHit = true;
+				OutHit.HitBoxIndex = Index;
+				OutHit.Distance = Distances[Index];
+			}
+		}
+
+		if (OutHit.bHit && Batch.bProxy) { OutHit.HitBoxIndex = -1; }
+		return OutHit.bHit;
+	}
+
+	/**
+	* Traces ray against all boxes of the batch one at a time and returns the closest hit.
+	* Start is relative to the same origin as the batch, Direction has to be normalized.
+	*/
+	inline bool LineTraceBatchScalar(const FHitBoxBatch& Batch, const FVec3& Start, const FVec3& Direction,
+		float MaxDistance, FRayHit& OutHit)
+	{
+		float Distances[MaxHitBoxes];
+		for (int32_t Index = 0; Index < Batch.NumHitBoxes; Index++)
+		{
+			const FVec3 Relative = Start - FVec3(Batch.CenterX[Index], Batch.CenterY[Index], Batch.CenterZ[Index]);
+
+			float Entry = 0.0f;
+			float Exit = MaxDistance;
+
+			for (int LocalAxis = 0; LocalAxis < 3 && Entry <= Exit; LocalAxis++)
+			{
+				const FVec3 Axis(Batch.Axis[LocalAxis][0][Index], Batch.Axis[LocalAxis][1][Index],
+					Batch.Axis[LocalAxis][2][Index]);
+				const float HalfSize = Batch.Extent[LocalAxis][Index];
+				const float Origin = Relative.Dot(Axis);
+				const float Slope = Direction.Dot(Axis);
+
+				if (std::fabs(Slope) < SmallNumber)
+				{
+					if (std::fabs(Origin) > HalfSize) { Entry = BigNumber; }
+					continue;
+				}
+
+				const float Near = (-HalfSize - Origin) / Slope;
+				const float Far = (HalfSize - Origin) / Slope;
+				Entry = std::fmax(Entry, std::fmin(Near, Far));
+				Exit = std::fmin(Exit, std::fmax(Near, Far));
+			}
+
+			Distances[Index] = Entry <= Exit ? Entry : BigNumber;
+		}
+		return FindClosestHit(Batch, Distances, OutHit);
+	}
+
+#if SERVERSIDEREWINDCORE_SIMD
+	/** Minimal set of four wide float operations the batched hit test needs */
+	namespace Vector4
+	{
+	#if defined(__aarch64__) || defined(_M_ARM64)
+		using FRegister = float32x4_t;
+		inline FRegister Set(float Value) { return vdupq_n_f32(Value); }
+		inline FRegister Load(const float* Values) { return vld1q_f32(Values); }
+		inline void Store(FRegister Value, float* Values) { vst1q_f32(Values, Value); }
+		inline FRegister Add(FRegister A, FRegister B) { return vaddq_f32(A, B); }
+		inline FRegister Subtract(FRegister A, FRegister B) { return vsubq_f32(A, B); }
+		inline FRegister Multiply(FRegister A, FRegister B) { return vmulq_f32(A, B); }
+		inline FRegister Divide(FRegister A, FRegister B) { return vdivq_f32(A, B); }
+		inline FRegister Min(FRegister A, FRegister B) { return vminq_f32(A, B); }
+		inline FRegister Max(FRegister A, FRegister B) { return vmaxq_f32(A, B); }
+		inline FRegister Abs(FRegister A) { return vabsq_f32(A); }
+		inline FRegister Negate(FRegister A) { return vnegq_f32(A); }
+		inline uint32x4_t CompareLess(FRegister A, FRegister B) { return vcltq_f32(A, B); }
+		inline uint32x4_t CompareLessEqual(FRegister A, FRegister B) { return vcleq_f32(A, B); }
+		inline FRegister Select(uint32x4_t Mask, FRegister A, FRegister B) { return vbslq_f32(Mask, A, B); }
+	#else
+		using FRegister = __m128;
+		inline FRegister Set(float Value) { return _mm_set1_ps(Value); }
+		inline FRegister Load(const float* Values) { return _mm_load_ps(Values); }
+		inline void Store(FRegister Value, float* Values) { _mm_store_ps(Values, Value); }
+		inline FRegister Add(FRegister A, FRegister B) { return _mm_add_ps(A, B); }
+		inline FRegister Subtract(FRegister A, FRegister B) { return _mm_sub_ps(A, B); }
+		inline FRegister Multiply(FRegister A, FRegister B) { return _mm_mul_ps(A, B); }
+		inline FRegister Divide(FRegister A, FRegister B) { return _mm_div_ps(A, B); }
+		inline FRegister Min(FRegister A, FRegister B) { return _mm_min_ps(A, B); }
+		inline FRegister Max(FRegister A, FRegister B) { return _mm_max_ps(A, B); }
+		inline FRegister Abs(FRegister A) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), A); }
+		inline FRegister Negate(FRegister A) { return _mm_xor_ps(_mm_set1_ps(-0.0f), A); }
+		inline FRegister CompareLess(FRegister A, FRegister B) { return _mm_cmplt_ps(A, B); }
+		inline FRegister CompareLessEqual(FRegister A, FRegister B) { return _mm_cmple_ps(A, B); }
+		inline FRegister Select(FRegister Mask, FRegister A, FRegister B)
+		{
+			return _mm_or_ps(_mm_and_ps(Mask, A), _mm_andnot_ps(Mask, B));
+		}
+	#endif
+	}
+#endif
+
+	/**
+	* Traces ray against all boxes of the batch and returns the closest hit.
+	* Tests four boxes per pass using vector registers without branching in the inner loop,
+	* falls back to LineTraceBatchScalar without vector intrinsics.
+	* Start is relative to the same origin as the batch, Direction has to be normalized.
+	*/
+	inline bool LineTraceBatch(const FHitBoxBatch& Batch, const FVec3& Start, const FVec3& Direction,
+		float MaxDistance, FRayHit& OutHit)
+	{
+#if SERVERSIDEREWINDCORE_SIMD
+		using namespace Vector4;
+
+		/** Distance of every lane to its box (BigNumber if missed) */
+		alignas(16) float Distances[MaxHitBoxes];
+
+		const FRegister StartX = Set(Start.X);
+		const FRegister StartY = Set(Start.Y);
+		const FRegister StartZ = Set(Start.Z);
+		const FRegister DirectionX = Set(Direction.X);
+		const FRegister DirectionY = Set(Direction.Y);
+		const FRegister DirectionZ = Set(Direction.Z);
+		const FRegister MaxLength = Set(MaxDistance);
+		const FRegister Infinity = Set(BigNumber);
+		const FRegister Epsilon = Set(SmallNumber);
+		const FRegister One = Set(1.0f);
+
+		/** Only the groups of four containing used lanes need to be tested */
+		const int32_t NumGroups = (Batch.NumHitBoxes + 3) / 4;
+		for (int32_t Group = 0; Group < NumGroups; Group++)
+		{
+			const int32_t Lane = Group * 4;
+
+			/** Ray start relative to the box centers */
+			const FRegister RelativeX = Subtract(StartX, Load(&Batch.CenterX[Lane]));
+			const FRegister RelativeY = Subtract(StartY, Load(&Batch.CenterY[Lane]));
+			const FRegister RelativeZ = Subtract(StartZ, Load(&Batch.CenterZ[Lane]));
+
+			FRegister Entry = Set(0.0f);
+			FRegister Exit = MaxLength;
+
+			for (int LocalAxis = 0; LocalAxis < 3; LocalAxis++)
+			{
+				const FRegister AxisX = Load(&Batch.Axis[LocalAxis][0][Lane]);
+				const FRegister AxisY = Load(&Batch.Axis[LocalAxis][1][Lane]);
+				const FRegister AxisZ = Load(&Batch.Axis[LocalAxis][2][Lane]);
+				const FRegister HalfSize = Load(&Batch.Extent[LocalAxis][Lane]);
+
+				/** Project ray onto the local axis */
+				const FRegister Origin = Add(Add(Multiply(RelativeX, AxisX), Multiply(RelativeY, AxisY)),
+					Multiply(RelativeZ, AxisZ));
+				FRegister Slope = Add(Add(Multiply(DirectionX, AxisX), Multiply(DirectionY, AxisY)),
+					Multiply(DirectionZ, AxisZ));
+
+				/**
+				* Replace slopes of rays parallel to the slab by a tiny one, which pushes both slab distances
+				* to +-infinity if the ray is inside the slab and to the same side of the ray if it's outside.
+				*/
+				Slope = Select(CompareLess(Abs(Slope), Epsilon), Epsilon, Slope);
+				const FRegister InverseSlope = Divide(One, Slope);
+
+				const FRegister Near = Multiply(Subtract(Negate(HalfSize), Origin), InverseSlope);
+				const FRegister Far = Multiply(Subtract(HalfSize, Origin), InverseSlope);
+
+				Entry = Max(Entry, Min(Near, Far));
+				Exit = Min(Exit, Max(Near, Far));
+			}
+
+			Store(Select(CompareLessEqual(Entry, Exit), Entry, Infinity), &Distances[Lane]);
+		}
+
+		/** Unused lanes of the last group are never looked at */
+		return FindClosestHit(Batch, Distances, OutHit);
+#else
+		return LineTraceBatchScalar(Batch, Start, Direction, MaxDistance, OutHit);
+#endif
+	}
+}
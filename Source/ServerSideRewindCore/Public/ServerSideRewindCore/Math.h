@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cmath>
+
+
+namespace ServerSideRewindCore
+{
+	/**
+	* Single precision vector. Locations are kept relative to a nearby origin (usually the character),
+	* so single precision is enough even far away from the world origin.
+	*/
+	struct FVec3
+	{
+		float X = 0.0f;
+		float Y = 0.0f;
+		float Z = 0.0f;
+
+		FVec3() = default;
+		FVec3(float InX, float InY, float InZ) : X(InX), Y(InY), Z(InZ) {}
+
+		FVec3 operator+(const FVec3& Other) const { return FVec3(X + Other.X, Y + Other.Y, Z + Other.Z); }
+		FVec3 operator-(const FVec3& Other) const { return FVec3(X - Other.X, Y - Other.Y, Z - Other.Z); }
+		FVec3 operator*(float Scale) const { return FVec3(X * Scale, Y * Scale, Z * Scale); }
+		float operator[](int Axis) const { return Axis == 0 ? X : (Axis == 1 ? Y : Z); }
+
+		float Dot(const FVec3& Other) const { return X * Other.X + Y * Other.Y + Z * Other.Z; }
+
+		FVec3 Cross(const FVec3& Other) const
+		{
+			return FVec3(Y * Other.Z - Z * Other.Y, Z * Other.X - X * Other.Z, X * Other.Y - Y * Other.X);
+		}
+
+		float Size() const { return std::sqrt(Dot(*this)); }
+	};
+
+	inline FVec3 Lerp(const FVec3& A, const FVec3& B, float Alpha) { return A + (B - A) * Alpha; }
+
+	/** Single precision rotation quaternion (same convention as FQuat) */
+	struct FQuat4
+	{
+		float X = 0.0f;
+		float Y = 0.0f;
+		float Z = 0.0f;
+		float W = 1.0f;
+
+		FQuat4() = default;
+		FQuat4(float InX, float InY, float InZ, float InW) : X(InX), Y(InY), Z(InZ), W(InW) {}
+
+		FVec3 RotateVector(const FVec3& Vector) const
+		{
+			/** V' = V + 2w(Q x V) + 2Q x (Q x V) */
+			const FVec3 Q(X, Y, Z);
+			const FVec3 T = Q.Cross(Vector) * 2.0f;
+			return Vector + T * W + Q.Cross(T);
+		}
+
+		FVec3 UnrotateVector(const FVec3& Vector) const
+		{
+			const FVec3 Q(-X, -Y, -Z);
+			const FVec3 T = Q.Cross(Vector) * 2.0f;
+			return Vector + T * W + Q.Cross(T);
+		}
+
+		FVec3 GetAxisX() const { return RotateVector(FVec3(1.0f, 0.0f, 0.0f)); }
+		FVec3 GetAxisY() const { return RotateVector(FVec3(0.0f, 1.0f, 0.0f)); }
+		FVec3 GetAxisZ() const { return RotateVector(FVec3(0.0f, 0.0f, 1.0f)); }
+	};
+
+	/** Spherical interpolation along the shortest path, falls back to a normalized lerp for nearly equal rotations */
+	inline FQuat4 Slerp(const FQuat4& A, const FQuat4& B, float Alpha)
+	{
+		float Cos = A.X * B.X + A.Y * B.Y + A.Z * B.Z + A.W * B.W;
+		const float Sign = Cos < 0.0f ? -1.0f : 1.0f;
+		Cos *= Sign;
+
+		float ScaleA = 1.0f - Alpha;
+		float ScaleB = Alpha * Sign;
+		if (Cos < 0.9999f)
+		{
+			const float Omega = std::acos(Cos);
+			const float InverseSin = 1.0f / std::sin(Omega);
+			ScaleA = std::sin(ScaleA * Omega) * InverseSin;
+			ScaleB = std::sin(Alpha * Omega) * InverseSin * Sign;
+		}
+
+		FQuat4 Result(ScaleA * A.X + ScaleB * B.X, ScaleA * A.Y + ScaleB * B.Y, ScaleA * A.Z + ScaleB * B.Z,
+			ScaleA * A.W + ScaleB * B.W);
+		const float InverseSize = 1.0f / std::sqrt(
+			Result.X * Result.X + Result.Y * Result.Y + Result.Z * Result.Z + Result.W * Result.W);
+		Result.X *= InverseSize;
+		Result.Y *= InverseSize;
+		Result.Z *= InverseSize;
+		Result.W *= InverseSize;
+		return Result;
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ServerSideRewindCore/RingIndex.h"
+#include <vector>
+
+
+namespace ServerSideRewindCore
+{
+	/** Default storage of TRingBuffer, a std::vector behind the SetNum / operator[] interface the ring needs */
+	template<typename ElementType>
+	class TVectorStorage
+	{
+	public:
+		void SetNum(int32_t Num) { Elements.resize(static_cast<size_t>(Num)); }
+
+		const ElementType& operator[](int32_t Index) const { return Elements[static_cast<size_t>(Index)]; }
+		ElementType& operator[](int32_t Index) { return Elements[static_cast<size_t>(Index)]; }
+
+	private:
+		std::vector<ElementType> Elements;
+	};
+
+	/**
+	* Fixed-capacity ring buffer. Storage is allocated once in Init, pushing never allocates
+	* and overwrites the oldest element once full.
+	* StorageType only needs SetNum and operator[], the engine instantiates it with a TArray
+	* (see TServerSideRewindRingBuffer).
+	*/
+	template<typename ElementType, typename StorageType = TVectorStorage<ElementType>>
+	class TRingBuffer
+	{
+	public:
+		/** Allocates storage for the specified amount of elements and empties the buffer */
+		void Init(int32_t InCapacity)
+		{
+			Elements.SetNum(InCapacity);
+			Index.Init(InCapacity);
+		}
+
+		/** Empties the buffer without releasing its storage */
+		void Reset() { Index.Reset(); }
+
+		int32_t Num() const { return Index.Num(); }
+		int32_t Capacity() const { return Index.GetCapacity(); }
+		bool IsEmpty() const { return Index.IsEmpty(); }
+		bool IsFull() const { return Index.IsFull(); }
+
+		/** Returns the slot following the newest element for overwriting, evicting the oldest one if full */
+		ElementType& Push() { return Elements[Index.Push()]; }
+
+		/** Removes the oldest element (the slot is kept for reuse) */
+		void PopOldest() { Index.PopOldest(); }
+
+		/** Access element by age, 0 being the oldest and Num() - 1 the newest */
+		const ElementType& operator[](int32_t Age) const { return Elements[Index.ToStorageIndex(Age)]; }
+		ElementType& operator[](int32_t Age) { return Elements[Index.ToStorageIndex(Age)]; }
+
+		const ElementType& GetOldest() const { return (*this)[0]; }
+		const ElementType& GetNewest() const { return (*this)[Num() - 1]; }
+
+	private:
+		StorageType Elements;
+		FRingIndex Index;
+	};
+}
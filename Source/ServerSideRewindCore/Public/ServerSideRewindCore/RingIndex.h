@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+
+
+namespace ServerSideRewindCore
+{
+	/**
+	* Index bookkeeping of a fixed-capacity ring buffer, independent of the storage holding the elements.
+	* Elements are addressed by age, 0 being the oldest and Num() - 1 the newest, and mapped to storage indices.
+	* Pushing onto a full ring reuses the storage index of the oldest element.
+	*/
+	class FRingIndex
+	{
+	public:
+		/** Sets the capacity and empties the ring */
+		void Init(int32_t InCapacity)
+		{
+			assert(InCapacity > 0);
+			Capacity = InCapacity;
+			Head = 0;
+			Count = 0;
+		}
+
+		/** Empties the ring, keeping its capacity */
+		void Reset()
+		{
+			Head = 0;
+			Count = 0;
+		}
+
+		int32_t Num() const { return Count; }
+		int32_t GetCapacity() const { return Capacity; }
+		bool IsEmpty() const { return Count == 0; }
+		bool IsFull() const { return Count == Capacity; }
+
+		/**
+		* Claims the storage index following the newest element.
+		* If the ring is full the oldest element is evicted and its storage index is returned.
+		*/
+		int32_t Push()
+		{
+			assert(Capacity > 0);
+
+			if (IsFull())
+			{
+				const int32_t StorageIndex = Head;
+				Head = Wrap(Head + 1);
+				return StorageIndex;
+			}
+
+			Count++;
+			return Wrap(Head + Count - 1);
+		}
+
+		/** Removes the oldest element */
+		void PopOldest()
+		{
+			assert(Count > 0);
+			Head = Wrap(Head + 1);
+			Count--;
+		}
+
+		/** Storage index of the element with the specified age (0 being the oldest) */
+		int32_t ToStorageIndex(int32_t Index) const
+		{
+			assert(Index >= 0 && Index < Count);
+			return Wrap(Head + Index);
+		}
+
+	private:
+		/** Storage index of the oldest element */
+		int32_t Head = 0;
+
+		/** Amount of valid elements */
+		int32_t Count = 0;
+
+		int32_t Capacity = 0;
+
+		int32_t Wrap(int32_t StorageIndex) const
+		{
+			return StorageIndex >= Capacity ? StorageIndex - Capacity : StorageIndex;
+		}
+	};
+}
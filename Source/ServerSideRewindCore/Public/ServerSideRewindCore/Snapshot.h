@@ -0,0 +1,56 @@
+#pragma once
+
+#include "ServerSideRewindCore/FrameTime.h"
+#include "ServerSideRewindCore/Math.h"
+#include <cstdint>
+
+
+namespace ServerSideRewindCore
+{
+	/** Max amount of hitboxes per character stored in a snapshot (multiple of 4 for the batched hit test) */
+	constexpr int32_t MaxHitBoxes = 16;
+
+	/**
+	* Hitboxes of one character at one point in time, locations relative to an origin chosen by the caller.
+	* Engine-independent counterpart of FServerSideRewindSnapshot, which is converted to it for interpolation.
+	*/
+	struct FHitBoxSnapshot
+	{
+		FFrameTime Time;
+
+		int32_t NumHitBoxes = 0;
+
+		/** Single box approximating the whole character, hits on it have no hitbox index */
+		bool bProxy = false;
+
+		FVec3 Locations[MaxHitBoxes];
+		FQuat4 Rotations[MaxHitBoxes];
+		FVec3 Extents[MaxHitBoxes];
+	};
+
+	/**
+	* Interpolates between two snapshots of the same character, Alpha being 0 at the older and 1 at the newer one.
+	* Only hitboxes present in both snapshots are interpolated. Proxies and hitboxes can't be interpolated,
+	* if the character changed between them the closer snapshot is used.
+	*/
+	inline void InterpolateSnapshots(const FHitBoxSnapshot& Older, const FHitBoxSnapshot& Newer, float Alpha,
+		FHitBoxSnapshot& OutSnapshot)
+	{
+		if (Older.bProxy != Newer.bProxy)
+		{
+			OutSnapshot = Alpha < 0.5f ? Older : Newer;
+			return;
+		}
+
+		OutSnapshot.Time = FFrameTime::Lerp(Older.Time, Newer.Time, Alpha);
+		OutSnapshot.bProxy = Older.bProxy;
+		OutSnapshot.NumHitBoxes = Older.NumHitBoxes < Newer.NumHitBoxes ? Older.NumHitBoxes : Newer.NumHitBoxes;
+
+		for (int32_t Index = 0; Index < OutSnapshot.NumHitBoxes; Index++)
+		{
+			OutSnapshot.Locations[Index] = Lerp(Older.Locations[Index], Newer.Locations[Index], Alpha);
+			OutSnapshot.Rotations[Index] = Slerp(Older.Rotations[Index], Newer.Rotations[Index], Alpha);
+			OutSnapshot.Extents[Index] = Lerp(Older.Extents[Index], Newer.Extents[Index], Alpha);
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "ServerSideRewindCore/FrameTime.h"
+#include <cstdint>
+
+
+namespace ServerSideRewindCore
+{
+	/** Frames surrounding a hit time and how far the hit time is between them */
+	struct FFrameLookup
+	{
+		int32_t OlderIndex = -1;
+		int32_t NewerIndex = -1;
+
+		/** 0 at the older frame, 1 at the newer frame */
+		float Alpha = 0.0f;
+	};
+
+	/**
+	* Finds the frames right before and after the hit time.
+	* GetFrameTime(Index) returns the time a frame was captured at, frames are ordered from oldest (0) to newest
+	* (NumFrames - 1) with at most one frame per frame number. Frames are captured whenever the server ticks,
+	* so their time is a frame number plus how far past it the tick was.
+	* Frames recorded every frame number are found by indexing directly, a binary search is only needed
+	* if frame numbers were skipped since the hit frame (frames not recorded at a reduced rate or a server hitch).
+	* Hit times newer than the newest frame use the newest frame, older ones than the oldest frame return false.
+	*/
+	template<typename GetFrameTimeType>
+	bool FindFramesToCheck(int32_t NumFrames, const GetFrameTimeType& GetFrameTime, const FFrameTime& Time,
+		FFrameLookup& OutLookup)
+	{
+		if (NumFrames <= 0) { return false; }
+
+		/** Too far back in the past */
+		const FFrameTime OldestTime = GetFrameTime(0);
+		if (Time < OldestTime) { return false; }
+
+		/** Hit time newer than or equal to latest frame, simply use latest frame */
+		OutLookup.NewerIndex = NumFrames - 1;
+		OutLookup.OlderIndex = OutLookup.NewerIndex;
+		OutLookup.Alpha = 0.0f;
+
+		if (!(Time < GetFrameTime(NumFrames - 1))) { return true; }
+
+		/**
+		* Frame of the hit frame number at its offset unless frames were skipped since,
+		* the frame before it if it was captured later within the frame than the hit time
+		*/
+		int32_t OlderIndex = Time.Frame - OldestTime.Frame;
+		if (OlderIndex < NumFrames && GetFrameTime(OlderIndex).Frame == Time.Frame)
+		{
+			if (Time < GetFrameTime(OlderIndex)) { OlderIndex--; }
+		}
+		else
+		{
+			/** Binary search for the first frame after the hit time (exists since the latest frame is after it) */
+			int32_t Low = 0;
+			int32_t High = NumFrames - 1;
+			while (Low < High)
+			{
+				const int32_t Middle = Low + (High - Low) / 2;
+				if (Time < GetFrameTime(Middle)) { High = Middle; }
+				else { Low = Middle + 1; }
+			}
+			OlderIndex = Low - 1;
+		}
+
+		OutLookup.OlderIndex = OlderIndex;
+		OutLookup.NewerIndex = OlderIndex + 1;
+
+		const FFrameTime OlderTime = GetFrameTime(OutLookup.OlderIndex);
+		const float FramesBetween = GetFrameTime(OutLookup.NewerIndex).FramesSince(OlderTime);
+		const float Alpha = FramesBetween > 0.0f ? Time.FramesSince(OlderTime) / FramesBetween : 0.0f;
+		OutLookup.Alpha = Alpha < 0.0f ? 0.0f : (Alpha > 1.0f ? 1.0f : Alpha);
+		return true;
+	}
+}